@@ -0,0 +1,66 @@
+#include <iostream>
+#include <cmath>
+#include <cstdlib>
+#include "vpg.h"
+
+// Shared processor estimates respiration in band 0 and heart rate in the added band 1 by one spectrum,
+// each band is compared with the processor of the same geometry that estimates only this band
+void compare(const char *mode, bool sliding, bool progressive, float &maxdifference)
+{
+    const float dTms = 33.0f;
+    vpg::PulseProcessor shared(dTms, vpg::PulseProcessor::Respiration);
+    vpg::PulseProcessor respiration(dTms, vpg::PulseProcessor::Respiration);
+    vpg::PulseProcessor heartrate(30000.0f, 10000.0f, 350.0f, dTms, vpg::PulseProcessor::HeartRate);
+    vpg::PulseProcessor *processors[] = {&shared, &respiration, &heartrate};
+    for(int p = 0; p < 3; p++) {
+        processors[p]->setSlidingSpectrum(sliding);
+        processors[p]->setProgressiveEstimation(progressive);
+    }
+    const int band = shared.addBand(0.8f, 2.5f);
+
+    float difference = 0.0f;
+    std::srand(9);
+    float t = 0.0f;
+    for(int i = 0; i < 3 * shared.getLength(); i++) {
+        const float time = dTms + static_cast<float>(std::rand() % 5) - 2.0f;
+        t += time / 1000.0f;
+        const float value = 100.0f + 2.0f * std::sin(2.0f * 3.14159265f * 0.27f * t) + std::sin(2.0f * 3.14159265f * 1.17f * t)
+                            + static_cast<float>(std::rand() % 1000) / 2000.0f;
+        for(int p = 0; p < 3; p++)
+            processors[p]->update(value, time);
+        if(i % 30 == 0) {
+            for(int p = 0; p < 3; p++)
+                processors[p]->computeFrequency();
+            const vpg::PulseEstimate pairs[][2] = {{shared.getEstimate(0), respiration.getEstimate()},
+                                                   {shared.getEstimate(band), heartrate.getEstimate()}};
+            for(int k = 0; k < 2; k++) {
+                difference = std::max(difference, std::abs(pairs[k][0].frequency - pairs[k][1].frequency));
+                difference = std::max(difference, std::abs(pairs[k][0].snr - pairs[k][1].snr));
+                difference = std::max(difference, std::abs(pairs[k][0].confidence - pairs[k][1].confidence));
+                difference = std::max(difference, std::abs(pairs[k][0].window - pairs[k][1].window));
+            }
+        }
+    }
+    std::cout << mode << ": " << shared.getEstimate(0).frequency << " /min and " << shared.getEstimate(band).frequency
+              << " bpm, max difference " << difference << std::endl;
+    maxdifference = std::max(maxdifference, difference);
+}
+
+int main()
+{
+    std::cout << "Run shared spectrum bands test:" << std::endl;
+
+    // All processors transform the same record, so results differ only if the sliding bins of the band union
+    // are accumulated in other order than the bins of one band
+    const float tolerance = 1e-3f;
+    float difference = 0.0f;
+    compare("full DFT", false, false, difference);
+    compare("sliding DFT", true, false, difference);
+    compare("progressive", false, true, difference);
+    if(difference > tolerance) {
+        std::cout << "Bands of the shared spectrum differ from the separate processors! Abort..." << std::endl;
+        return 1;
+    }
+    std::cout << "Test passed" << std::endl;
+    return 0;
+}
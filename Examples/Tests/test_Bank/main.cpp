@@ -0,0 +1,79 @@
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include "vpg.h"
+
+// Synthetic trace of the stream: pulse wave of its own rate, breathing drift and noise, stream 0 is a constant
+float count(int stream, int i, unsigned int &seed)
+{
+    seed = seed * 1103515245u + 12345u;
+    const float noise = static_cast<float>((seed >> 16) % 1000) / 1000.0f - 0.5f;
+    if(stream == 0)
+        return 100.0f;
+    const float t = 0.033f * i;
+    return 100.0f + 10.0f * stream + (1.0f + 0.3f * stream) * std::sin(2.0f * 3.14159265f * (0.9f + 0.2f * stream) * t)
+            + 0.7f * std::sin(2.0f * 3.14159265f * 0.25f * t) + 0.3f * noise;
+}
+
+int main()
+{
+    std::cout << "Run pulse processor bank test:" << std::endl;
+
+    const int streams = 6, counts = 2000, resetAt = 900, resetStream = 3;
+    const float dTms = 33.0f;
+    vpg::PulseProcessorBank bank(streams, dTms);
+    std::vector<vpg::PulseProcessor*> processors;
+    std::vector<vpg::PeakDetector*> detectors;
+    for(int s = 0; s < streams; s++) {
+        processors.push_back(new vpg::PulseProcessor(dTms));
+        detectors.push_back(new vpg::PeakDetector(processors[s]->getLength(), 25, 11, dTms));
+        processors[s]->setPeakDetector(detectors[s]);
+    }
+
+    // Counts of all streams are the same as the single processors get, tolerances cover rounding of the running sums,
+    // anchoring schedule of the bank is shared, so reset of one stream anchors the others at different moments
+    const float signalTolerance = 1e-4f, frequencyTolerance = 1e-3f;
+    float signalDifference = 0.0f, frequencyDifference = 0.0f, intervalDifference = 0.0f;
+    std::vector<float> values(streams), times(streams);
+    unsigned int seed = 1;
+    for(int i = 0; i < counts; i++) {
+        if(i == resetAt) {
+            bank.reset(resetStream);
+            processors[resetStream]->reset();
+            detectors[resetStream]->reset();
+        }
+        for(int s = 0; s < streams; s++) {
+            values[s] = count(s, i, seed);
+            times[s] = dTms + static_cast<float>((i + s) % 3) - 1.0f;
+            processors[s]->update(values[s], times[s]);
+        }
+        bank.update(values.data(), times.data());
+        for(int s = 0; s < streams; s++) {
+            signalDifference = std::max(signalDifference, std::abs(bank.getSignalSampleValue(s) - processors[s]->getSignalSampleValue()));
+            signalDifference = std::max(signalDifference, std::abs(bank.getSignalStdev(s) - processors[s]->getSignalStdev()));
+            intervalDifference = std::max(intervalDifference, std::abs(bank.getCurrentInterval(s) - detectors[s]->getCurrentInterval()));
+            intervalDifference = std::max(intervalDifference, std::abs(bank.averageCardiointervalms(s) - detectors[s]->averageCardiointervalms()));
+        }
+        if(i % 10 == 0) {
+            bank.computeFrequencies();
+            for(int s = 0; s < streams; s++) {
+                processors[s]->computeFrequency();
+                frequencyDifference = std::max(frequencyDifference, std::abs(bank.getFrequency(s) - processors[s]->getFrequency()));
+                frequencyDifference = std::max(frequencyDifference, std::abs(bank.getSNR(s) - processors[s]->getSNR()));
+            }
+        }
+    }
+    for(int s = 0; s < streams; s++) {
+        std::cout << "stream " << s << ": " << bank.getFrequency(s) << " bpm, " << bank.getCurrentInterval(s) << " ms interval" << std::endl;
+        delete processors[s];
+        delete detectors[s];
+    }
+    std::cout << "max difference of signal " << signalDifference << ", of frequency and snr " << frequencyDifference
+              << ", of intervals " << intervalDifference << " ms" << std::endl;
+    if(signalDifference > signalTolerance || frequencyDifference > frequencyTolerance || intervalDifference > 0.0f) {
+        std::cout << "Bank differs from the single processors! Abort..." << std::endl;
+        return 1;
+    }
+    std::cout << "Test passed" << std::endl;
+    return 0;
+}
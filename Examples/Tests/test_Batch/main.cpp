@@ -0,0 +1,49 @@
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include "vpg.h"
+
+// Feeds the same counts by update() and by updateBatch(), signals should not differ
+float maxDifference(vpg::PulseProcessor &single, vpg::PulseProcessor &batch, const std::vector<float> &values, const std::vector<float> &times, size_t block)
+{
+    for(size_t i = 0; i < values.size(); i++)
+        single.update(values[i], times[i]);
+    for(size_t i = 0; i < values.size(); i += block)
+        batch.updateBatch(values.data() + i, times.data() + i, std::min(block, values.size() - i));
+    float difference = 0.0f;
+    const float *s = single.getWindow(), *b = batch.getWindow();
+    for(int i = 0; i < single.getLength(); i++)
+        difference = std::max(difference, std::abs(s[i] - b[i]));
+    return difference;
+}
+
+int main()
+{
+    std::cout << "Run batch update test:" << std::endl;
+
+    const float dTms = 33.0f;
+    std::vector<float> values(2000), times(2000);
+    for(size_t i = 0; i < values.size(); i++) {
+        times[i] = dTms + static_cast<float>(i % 5) - 2.0f;
+        values[i] = 100.0f + 3.0f * std::sin(0.2f * i) + std::sin(1.3f * i);
+    }
+
+    // Regular record and the record that is completely occupied by the centering window (Tcn_ms == Tov_ms)
+    const float intervals[][3] = {{7500.0f, 400.0f, 350.0f}, {400.0f, 400.0f, 350.0f}};
+    const size_t blocks[] = {1, 64, 2000};
+    for(int c = 0; c < 2; c++) {
+        for(int b = 0; b < 3; b++) {
+            vpg::PulseProcessor single(intervals[c][0], intervals[c][1], intervals[c][2], dTms, vpg::PulseProcessor::HeartRate);
+            vpg::PulseProcessor batch(intervals[c][0], intervals[c][1], intervals[c][2], dTms, vpg::PulseProcessor::HeartRate);
+            const float difference = maxDifference(single, batch, values, times, blocks[b]);
+            std::cout << "Tov " << intervals[c][0] << " ms, Tcn " << intervals[c][1] << " ms, block " << blocks[b]
+                      << ": max difference " << difference << std::endl;
+            if(difference > 1e-3f) {
+                std::cout << "Signals are different! Abort..." << std::endl;
+                return 1;
+            }
+        }
+    }
+    std::cout << "Test passed" << std::endl;
+    return 0;
+}
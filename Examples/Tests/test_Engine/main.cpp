@@ -0,0 +1,93 @@
+#include <iostream>
+#include <cmath>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include "vpg.h"
+
+const int kinds = 8;
+const char *names[kinds] = {"plain", "plain", "plain of 20 ms", "zoom", "respiration and heart rate", "sliding", "async", "progressive"};
+
+// Processor of the kind, engine and twin processors of the same kind should give the same results
+vpg::PulseProcessor *create(int kind)
+{
+    vpg::PulseProcessor *processor = new vpg::PulseProcessor(kind == 2 ? 20.0f : 33.0f, kind == 4 ? vpg::PulseProcessor::Respiration : vpg::PulseProcessor::HeartRate);
+    switch(kind) {
+        case 3:
+            processor->setSpectrumZoom(8);
+            break;
+        case 4:
+            processor->addBand(0.8f, 2.5f);
+            break;
+        case 5:
+            processor->setSlidingSpectrum(true);
+            break;
+        case 6:
+            processor->setAsyncEstimation(true);
+            break;
+        case 7:
+            processor->setProgressiveEstimation(true);
+            break;
+    }
+    return processor;
+}
+
+int main()
+{
+    std::cout << "Run spectrum engine test:" << std::endl;
+
+    vpg::SpectrumEngine engine;
+    vpg::PulseProcessor *batched[kinds], *single[kinds];
+    for(int k = 0; k < kinds; k++) {
+        batched[k] = create(k);
+        single[k] = create(k);
+        engine.add(batched[k]);
+    }
+
+    // Engine transforms the same windows by the row-wise DFT and searches each row by the same code,
+    // other processors compute by themselves, so results should be identical
+    const float tolerance = 1e-4f;
+    float difference = 0.0f;
+    std::srand(21);
+    float t = 0.0f;
+    for(int i = 0; i < 1000; i++) {
+        const float time = 33.0f + static_cast<float>(std::rand() % 7) - 3.0f;
+        t += time / 1000.0f;
+        for(int k = 0; k < kinds; k++) {
+            const float value = 50.0f + std::sin(2.0f * 3.14159265f * (0.9f + 0.15f * k) * t) + 0.5f * std::sin(2.0f * 3.14159265f * 0.3f * t)
+                                + static_cast<float>(std::rand() % 1000) / 2000.0f;
+            batched[k]->update(value, time);
+            single[k]->update(value, time);
+        }
+        // Estimations of the async processors have been taken by the updates
+        for(int k = 0; k < kinds; k++)
+            for(int b = 0; b < batched[k]->getBands(); b++) {
+                difference = std::max(difference, std::abs(batched[k]->getEstimate(b).frequency - single[k]->getEstimate(b).frequency));
+                difference = std::max(difference, std::abs(batched[k]->getEstimate(b).snr - single[k]->getEstimate(b).snr));
+                difference = std::max(difference, std::abs(batched[k]->getEstimate(b).confidence - single[k]->getEstimate(b).confidence));
+                difference = std::max(difference, std::abs(batched[k]->getEstimate(b).window - single[k]->getEstimate(b).window));
+            }
+        if(i % 10 == 0) {
+            engine.compute();
+            for(int k = 0; k < kinds; k++)
+                single[k]->computeFrequency();
+            // Async workers finish before the next update
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+    }
+    for(int k = 0; k < kinds; k++) {
+        std::cout << names[k] << ": " << batched[k]->getFrequency() << " bpm";
+        for(int b = 1; b < batched[k]->getBands(); b++)
+            std::cout << ", band " << b << ": " << batched[k]->getEstimate(b).frequency << " bpm";
+        std::cout << std::endl;
+        delete batched[k];
+        delete single[k];
+    }
+    std::cout << "max difference of frequency, snr, confidence and window " << difference << std::endl;
+    if(difference > tolerance) {
+        std::cout << "Engine differs from computeFrequency()! Abort..." << std::endl;
+        return 1;
+    }
+    std::cout << "Test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include <iostream>
+#include <cstdlib>
+#include "vpg.h"
+
+// Per-pixel loop that FaceProcessor::enrollImage used before vectorization
+static bool skinColor(unsigned char vR, unsigned char vG, unsigned char vB)
+{
+    return (vR > 95) && (vR > vG) && (vG > 40) && (vB > 20) && ((vR - std::min(vG,vB)) > 5) && ((vR - vG) > 5);
+}
+
+static bool insideEllipse(const cv::Rect &ellRect, int x, int y)
+{
+    float cx = (ellRect.x + ellRect.width / 2.0f - x) / (ellRect.width / 2.0f);
+    float cy = (ellRect.y + ellRect.height / 2.0f - y) / (ellRect.height / 2.0f);
+    return (cx*cx + cy*cy) < 1.0f;
+}
+
+static void referenceLoop(const cv::Mat &region, const cv::Rect &ellRect, unsigned long &area, unsigned long &green)
+{
+    for(int j = 0; j < region.rows; j++) {
+        const unsigned char *ptr = region.ptr(j);
+        for(int i = ellRect.x; i < ellRect.x + ellRect.width; i++) {
+            unsigned char tB = ptr[3*i], tG = ptr[3*i+1], tR = ptr[3*i+2];
+            if(skinColor(tR, tG, tB) && insideEllipse(ellRect, i, j)) {
+                area++;
+                green += tG;
+            }
+        }
+    }
+}
+
+static void kernelLoop(const cv::Mat &region, const std::vector<cv::Range> &spans, unsigned long &area, unsigned long &green)
+{
+    for(int j = 0; j < region.rows; j++) {
+        unsigned int rowArea = 0, rowGreen = 0;
+        vpg::accumulateSkinRow(region.ptr(j), spans[j].start, spans[j].end, rowArea, rowGreen);
+        area += rowArea;
+        green += rowGreen;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    std::cout << "Run enrollment kernel benchmark:" << std::endl;
+
+    // Face region of the size we usually get from 1080p video
+    const int W = 500, H = 600, iterations = argc > 1 ? std::atoi(argv[1]) : 200;
+    cv::Mat region(H, W, CV_8UC3);
+    std::srand(7);
+    for(int j = 0; j < H; j++) {
+        unsigned char *p = region.ptr(j);
+        for(int i = 0; i < 3*W; i++)
+            p[i] = static_cast<unsigned char>(std::rand() % 256);
+    }
+    const int dX = W / 16, dY = H / 30;
+    const cv::Rect ellRect(dX, -6 * dY, W - 2 * dX, H + 6 * dY);
+    // FaceProcessor rebuilds spans only when the ellipse changes, so they are not counted in the timing
+    std::vector<cv::Range> spans;
+    vpg::computeEllipseSpans(ellRect, H, spans);
+
+    unsigned long refArea = 0, refGreen = 0, simdArea = 0, simdGreen = 0;
+    referenceLoop(region, ellRect, refArea, refGreen);
+    kernelLoop(region, spans, simdArea, simdGreen);
+    std::cout << "Reference: area " << refArea << ", green " << refGreen << std::endl
+              << "Kernel:    area " << simdArea << ", green " << simdGreen << std::endl;
+    if(refArea != simdArea || refGreen != simdGreen) {
+        std::cout << "Results are different! Abort..." << std::endl;
+        return 1;
+    }
+
+    int64 t0 = cv::getTickCount();
+    for(int k = 0; k < iterations; k++) {
+        refArea = refGreen = 0;
+        referenceLoop(region, ellRect, refArea, refGreen);
+    }
+    int64 t1 = cv::getTickCount();
+    for(int k = 0; k < iterations; k++) {
+        simdArea = simdGreen = 0;
+        kernelLoop(region, spans, simdArea, simdGreen);
+    }
+    int64 t2 = cv::getTickCount();
+
+    double refms = 1000.0 * (t1 - t0) / cv::getTickFrequency() / iterations;
+    double simdms = 1000.0 * (t2 - t1) / cv::getTickFrequency() / iterations;
+    std::cout << "Reference loop: " << refms << " ms per frame" << std::endl
+              << "Kernel loop:    " << simdms << " ms per frame" << std::endl
+              << "Speedup:        " << refms / simdms << std::endl;
+    return 0;
+}
@@ -0,0 +1,40 @@
+#include <iostream>
+#include <cmath>
+#include "vpg.h"
+
+// Feeds timestamps of the source that switches frame rate in the middle of the stream, every lostEvery frame is lost
+float finalPeriod(float firstPeriod_ms, float secondPeriod_ms, int lostEvery)
+{
+    vpg::FramePeriodEstimator estimator;
+    double timestamp = 1000.0;
+    for(int i = 0; i < 600; i++) {
+        const float period = i < 300 ? firstPeriod_ms : secondPeriod_ms;
+        // Jitter of the capture moments
+        timestamp += period + 0.1f * period * std::sin(1.7f * i);
+        if(lostEvery > 0 && (i % lostEvery) == 0)
+            continue;
+        estimator.update(timestamp);
+    }
+    return estimator.getPeriod();
+}
+
+int main()
+{
+    std::cout << "Run frame period estimation test:" << std::endl;
+
+    // 30 fps source switches to 20, 15, 75 fps and stays at 30 fps with lost frames
+    const float periods[][3] = {{33.3f, 50.0f, 0.0f}, {33.3f, 66.7f, 0.0f}, {33.3f, 13.3f, 0.0f}, {33.3f, 33.3f, 7.0f}, {50.0f, 33.3f, 0.0f}};
+    for(int i = 0; i < 5; i++) {
+        const float period = finalPeriod(periods[i][0], periods[i][1], static_cast<int>(periods[i][2]));
+        std::cout << periods[i][0] << " -> " << periods[i][1] << " ms";
+        if(periods[i][2] > 0.0f)
+            std::cout << ", every " << periods[i][2] << " frame is lost";
+        std::cout << ": estimation " << period << " ms" << std::endl;
+        if(std::abs(period - periods[i][1]) > 0.03f * periods[i][1]) {
+            std::cout << "Estimation does not follow the frame rate! Abort..." << std::endl;
+            return 1;
+        }
+    }
+    std::cout << "Test passed" << std::endl;
+    return 0;
+}
@@ -9,6 +9,9 @@ int main(int argc, char *argv[])
     vpg::PulseProcessor *proc = new vpg::PulseProcessor(dTms, vpg::PulseProcessor::HeartRate);
     vpg::PeakDetector   *pdet = new vpg::PeakDetector(proc->getLength(),50,33,dTms);
     proc->setPeakDetector(pdet);
+    // Half of the record length with zoomed spectrum
+    vpg::PulseProcessor *zproc = new vpg::PulseProcessor(Tovms/2, 400.0f, 350.0f, dTms, vpg::PulseProcessor::HeartRate);
+    zproc->setSpectrumZoom(8);
 
     float sV = 0.0f, f0 = 0.8f, meas;
     for(uint i = 0; i < 25; i++) {
@@ -18,11 +21,16 @@ int main(int argc, char *argv[])
         for(uint j = 0; j < Tovms/dTms; j++) {
             sV = std::sin( 2 * 3.1415926 * f * j * dTms/1000.0 + _phaseshift) + 125.0;
             proc->update(sV, dTms);
+            zproc->update(sV, dTms);
             if(j % 100 == 0) {
                 meas = proc->computeFrequency();
                 std::cout << "Measurement (FFT):\t"
                           << meas << " bpm,\terr: "
                           << (int)std::abs(meas - f*60.0) << " bpm\n";
+                meas = zproc->computeFrequency();
+                std::cout << "Measurement (zoom):\t"
+                          << meas << " bpm,\terr: "
+                          << (int)std::abs(meas - f*60.0) << " bpm\n";
                 meas = 60000.0f / pdet->averageCardiointervalms();
                 std::cout << "Measurement (HRV):\t"
                           << meas << " bpm,\terr: "
@@ -32,5 +40,6 @@ int main(int argc, char *argv[])
         std::cout << "\n";
     }
     delete proc;
+    delete zproc;
     return 0;
 }
@@ -0,0 +1,59 @@
+#include <iostream>
+#include <cstdlib>
+#include "vpg.h"
+
+int main(int argc, char *argv[])
+{
+    std::cout << "Run integral image benchmark:" << std::endl;
+
+    // Frame of the size we usually get from the webcam
+    const int W = 640, H = 480, iterations = argc > 1 ? std::atoi(argv[1]) : 20;
+    cv::Mat frame(H, W, CV_8UC3);
+    std::srand(7);
+    for(int j = 0; j < H; j++) {
+        unsigned char *p = frame.ptr(j);
+        for(int i = 0; i < 3*W; i++)
+            p[i] = static_cast<unsigned char>(std::rand() % 256);
+    }
+
+    vpg::FaceProcessor faceproc;
+    float r0, g0, b0, r1, g1, b1, t;
+    const int counts[] = {1, 4, 16, 64, 256, 1024};
+    std::cout << "ROIs\tDirect, ms\tIntegral, ms\tSpeedup" << std::endl;
+    for(int c = 0; c < static_cast<int>(sizeof(counts)/sizeof(counts[0])); c++) {
+        // Grid-search like workload: random patches from 32x32 up to a quarter of the frame
+        std::vector<cv::Rect> rois(counts[c]);
+        for(size_t k = 0; k < rois.size(); k++) {
+            const int w = 32 + std::rand() % (W / 2 - 32), h = 32 + std::rand() % (H / 2 - 32);
+            rois[k] = cv::Rect(std::rand() % (W - w), std::rand() % (H - h), w, h);
+        }
+
+        faceproc.buildIntegral(frame);
+        for(size_t k = 0; k < rois.size(); k++) {
+            faceproc.enrollImagePart(frame, r0, g0, b0, t, rois[k]);
+            faceproc.enrollIntegralPart(r1, g1, b1, t, rois[k]);
+            if(r0 != r1 || g0 != g1 || b0 != b1) {
+                std::cout << "Results are different for " << rois[k] << "! Abort..." << std::endl;
+                return 1;
+            }
+        }
+
+        int64 t0 = cv::getTickCount();
+        for(int n = 0; n < iterations; n++)
+            for(size_t k = 0; k < rois.size(); k++)
+                faceproc.enrollImagePart(frame, r0, g0, b0, t, rois[k]);
+        int64 t1 = cv::getTickCount();
+        for(int n = 0; n < iterations; n++) {
+            // Table is built once per frame, so its cost is included
+            faceproc.buildIntegral(frame);
+            for(size_t k = 0; k < rois.size(); k++)
+                faceproc.enrollIntegralPart(r1, g1, b1, t, rois[k]);
+        }
+        int64 t2 = cv::getTickCount();
+
+        double directms = 1000.0 * (t1 - t0) / cv::getTickFrequency() / iterations;
+        double integralms = 1000.0 * (t2 - t1) / cv::getTickFrequency() / iterations;
+        std::cout << counts[c] << "\t" << directms << "\t\t" << integralms << "\t\t" << directms / integralms << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include <iostream>
+#include "vpg.h"
+
+// Cascade that finds the face where the test puts it, if the face fits the searched image or its part
+class ScriptedCascade : public cv::BaseCascadeClassifier
+{
+public:
+    ScriptedCascade() : wholeFrameSearches(0) {}
+    cv::Rect face; // frame coordinates, empty if there is no face
+    int wholeFrameSearches;
+
+    bool empty() const { return false; }
+    bool load(const cv::String &) { return true; }
+    void detectMultiScale(cv::InputArray image, std::vector<cv::Rect> &objects, double, int, int, cv::Size, cv::Size)
+    {
+        objects.clear();
+        const cv::Mat _image = image.getMat();
+        cv::Size _whole;
+        cv::Point _offset;
+        _image.locateROI(_whole, _offset);
+        if(_image.size() == _whole)
+            wholeFrameSearches++;
+        const cv::Rect _face = face - _offset;
+        if(face.area() > 0 && (_face & cv::Rect(0, 0, _image.cols, _image.rows)) == _face)
+            objects.push_back(_face);
+    }
+    void detectMultiScale(cv::InputArray image, std::vector<cv::Rect> &objects, std::vector<int> &, double scaleFactor, int minNeighbors, int flags, cv::Size minSize, cv::Size maxSize)
+    {
+        detectMultiScale(image, objects, scaleFactor, minNeighbors, flags, minSize, maxSize);
+    }
+    void detectMultiScale(cv::InputArray image, std::vector<cv::Rect> &objects, std::vector<int> &, std::vector<double> &, double scaleFactor, int minNeighbors, int flags, cv::Size minSize, cv::Size maxSize, bool)
+    {
+        detectMultiScale(image, objects, scaleFactor, minNeighbors, flags, minSize, maxSize);
+    }
+    bool isOldFormatCascade() const { return false; }
+    cv::Size getOriginalWindowSize() const { return cv::Size(20, 20); }
+    int getFeatureType() const { return 0; }
+    void *getOldCascade() { return 0; }
+    void setMaskGenerator(const cv::Ptr<MaskGenerator> &) {}
+    cv::Ptr<MaskGenerator> getMaskGenerator() { return cv::Ptr<MaskGenerator>(); }
+};
+
+// Face is seen on 40 frames, then it is lost, returns the number of frames until the face rect is dropped
+int framesUntilDrop(unsigned int maxMisses, int &wholeFrameSearches)
+{
+    cv::Mat frame(240, 320, CV_8UC3, cv::Scalar(90, 120, 200));
+    ScriptedCascade *cascade = new ScriptedCascade();
+    cv::CascadeClassifier classifier;
+    classifier.cc = cv::Ptr<cv::BaseCascadeClassifier>(cascade);
+    vpg::FaceProcessor proc;
+    proc.setClassifier(&classifier);
+    proc.setLocalSearch(true, maxMisses);
+
+    float v, t;
+    cascade->face = cv::Rect(120, 70, 80, 90);
+    for(int i = 0; i < 40; i++)
+        proc.enrollImage(frame, v, t);
+    cascade->face = cv::Rect();
+    int frames = 0;
+    while(proc.getFaceRect().area() > 0 && frames < 1000) {
+        proc.enrollImage(frame, v, t);
+        frames++;
+    }
+    wholeFrameSearches = cascade->wholeFrameSearches;
+    return frames;
+}
+
+int main()
+{
+    std::cout << "Run local search test:" << std::endl;
+
+    // Miss and recover: face is lost for less frames than the budget allows and returns shifted inside the window,
+    // so it is reported on every frame and the whole frame is searched only once, when the face is seen first
+    const unsigned int maxMisses = 4;
+    cv::Mat frame(240, 320, CV_8UC3, cv::Scalar(90, 120, 200));
+    ScriptedCascade *cascade = new ScriptedCascade();
+    cv::CascadeClassifier classifier;
+    classifier.cc = cv::Ptr<cv::BaseCascadeClassifier>(cascade);
+    vpg::FaceProcessor proc;
+    proc.setClassifier(&classifier);
+    proc.setLocalSearch(true, maxMisses);
+    float v, t;
+    int lostframes = 0;
+    for(int i = 0; i < 200; i++) {
+        const int phase = i % 20;
+        cascade->face = (phase >= 10 && phase < 10 + static_cast<int>(maxMisses) - 1) ? cv::Rect() : cv::Rect(120 + (i / 20) % 3, 70, 80, 90);
+        proc.enrollImage(frame, v, t);
+        if(proc.getFaceRect().area() == 0)
+            lostframes++;
+    }
+    std::cout << "miss and recover: " << lostframes << " frames without face, " << cascade->wholeFrameSearches << " whole frame searches, "
+              << proc.getDetectorCalls() << " detector calls, " << proc.getDetectionHits() << " detection hits" << std::endl;
+    if(lostframes > 0 || cascade->wholeFrameSearches != 1) {
+        std::cout << "Face is lost inside the miss budget! Abort..." << std::endl;
+        return 1;
+    }
+
+    // Face leaves: misses inside the budget report the last face, so the rect is dropped maxMisses - 1 frames later
+    // than without the budget, whole frame is searched on each frame after the budget, so searches are the same
+    int searchesOne, searchesBudget;
+    const int one = framesUntilDrop(1, searchesOne), budget = framesUntilDrop(maxMisses, searchesBudget);
+    std::cout << "face leaves: rect is dropped after " << one << " frames with 1 miss allowed and after " << budget << " frames with "
+              << maxMisses << " misses allowed" << std::endl;
+    if(budget - one != static_cast<int>(maxMisses) - 1 || searchesBudget != searchesOne) {
+        std::cout << "Miss budget is not respected! Abort..." << std::endl;
+        return 1;
+    }
+    std::cout << "Test passed" << std::endl;
+    return 0;
+}
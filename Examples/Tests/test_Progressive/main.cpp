@@ -0,0 +1,79 @@
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include <cstdlib>
+#include "vpg.h"
+
+int main()
+{
+    std::cout << "Run progressive estimation test:" << std::endl;
+
+    const float dTms = 33.0f, Tcnms = 400.0f, minWindowms = 2000.0f;
+    vpg::PulseProcessor progressive(dTms), full(dTms);
+    progressive.setProgressiveEstimation(true, minWindowms);
+    const int length = progressive.getLength(), warmup = static_cast<int>(Tcnms / dTms);
+
+    // Reference pads the filled part of the record without warm-up counts by zeros, transforms it by direct DFT
+    // in double precision and searches the band as the full DFT path does, so only DFT rounding differs
+    const float frequencyTolerance = 1e-2f, snrTolerance = 1e-2f, windowTolerance = 1e-3f;
+    float frequencyDifference = 0.0f, snrDifference = 0.0f, windowDifference = 0.0f;
+    float frequency = 0.0f, snr = 0.0f, window = 0.0f;
+    int estimations = 0;
+    std::vector<float> times, padded(length), power(length/2 + 1);
+    std::srand(3);
+    float t = 0.0f;
+    for(int i = 0; i < 2 * length; i++) {
+        const float time = dTms + static_cast<float>(std::rand() % 7) - 3.0f;
+        t += time / 1000.0f;
+        const float value = 70.0f + std::sin(2.0f * 3.14159265f * 1.15f * t) + static_cast<float>(std::rand() % 1000) / 3000.0f;
+        progressive.update(value, time);
+        full.update(value, time);
+        times.push_back(time);
+        if(i % 3 != 0)
+            continue;
+        progressive.computeFrequency();
+        full.computeFrequency();
+
+        const int n = std::min(i + 1, length) - warmup;
+        float prefixms = 0.0f;
+        for(int k = 0; k < n; k++)
+            prefixms += times[times.size() - n + k];
+        if(i + 1 >= length) { // record is filled, so both processors run the same full DFT path
+            frequencyDifference = std::max(frequencyDifference, std::abs(progressive.getEstimate().frequency - full.getEstimate().frequency));
+            snrDifference = std::max(snrDifference, std::abs(progressive.getEstimate().snr - full.getEstimate().snr));
+        } else if(n > 0 && prefixms >= minWindowms) {
+            const float *signal = progressive.getWindow();
+            for(int k = 0; k < length; k++)
+                padded[k] = k < length - n ? 0.0f : signal[k];
+            for(int f = 0; f <= length/2; f++) {
+                double re = 0.0, im = 0.0;
+                for(int k = 0; k < length; k++) {
+                    re += padded[k] * std::cos(2.0 * 3.14159265358979 * f * k / length);
+                    im -= padded[k] * std::sin(2.0 * 3.14159265358979 * f * k / length);
+                }
+                power[f] = static_cast<float>(re*re + im*im);
+            }
+            const float time_ms = prefixms * length / n;
+            if(vpg::estimatePulseFrequency(power.data(), static_cast<int>(0.8f * time_ms / 1000.0f),
+                                           std::min(length/2, static_cast<int>(2.5f * time_ms / 1000.0f)), time_ms, frequency, snr))
+                window = prefixms;
+            frequencyDifference = std::max(frequencyDifference, std::abs(progressive.getEstimate().frequency - frequency));
+            snrDifference = std::max(snrDifference, std::abs(progressive.getEstimate().snr - snr));
+            windowDifference = std::max(windowDifference, std::abs(progressive.getEstimate().window - window));
+            estimations++;
+        } else if(progressive.getEstimate().window > 0.0f) {
+            std::cout << "Estimation is made by " << n << " counts of " << prefixms << " ms! Abort..." << std::endl;
+            return 1;
+        }
+    }
+    std::cout << estimations << " prefix estimations, last one " << frequency << " bpm of snr " << snr << " dB by "
+              << window << " ms, full record gives " << full.getFrequency() << " bpm" << std::endl
+              << "max difference of frequency " << frequencyDifference << " bpm, of snr " << snrDifference
+              << " dB, of window " << windowDifference << " ms" << std::endl;
+    if(estimations == 0 || frequencyDifference > frequencyTolerance || snrDifference > snrTolerance || windowDifference > windowTolerance) {
+        std::cout << "Progressive estimation differs from the direct recomputation! Abort..." << std::endl;
+        return 1;
+    }
+    std::cout << "Test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include <cstdlib>
+#include "vpg.h"
+
+float count(float t)
+{
+    return 80.0f + std::sin(2.0f * 3.14159265f * 1.25f * t) + static_cast<float>(std::rand() % 1000) / 3000.0f;
+}
+
+int main()
+{
+    std::cout << "Run reconfiguration test:" << std::endl;
+
+    // Camera switches from 30 to 50 fps, processor keeps its history, the fresh one starts at 50 fps from nothing
+    const float Tovms = 7500.0f, Tcnms = 400.0f, Tlpfms = 350.0f, dTms = 33.0f, newdTms = 20.0f;
+    vpg::PulseProcessor processor(Tovms, Tcnms, Tlpfms, dTms, vpg::PulseProcessor::HeartRate);
+    std::srand(17);
+    float t = 0.0f;
+    std::vector<float> times;
+    for(int i = 0; i < 2 * processor.getLength(); i++) {
+        times.push_back(dTms + static_cast<float>(std::rand() % 7) - 3.0f);
+        t += times.back() / 1000.0f;
+        processor.update(count(t), times.back());
+    }
+    processor.computeFrequency();
+    const float before = processor.getFrequency();
+    const int length = processor.getLength();
+    const std::vector<float> history(processor.getWindow(), processor.getWindow() + length);
+
+    processor.reconfigure(Tovms, Tcnms, Tlpfms, newdTms);
+    // Reference places old counts backwards from the newest one by their durations and interpolates them linearly
+    // at the moments of the new grid in double precision, moments older than the history get zeros
+    const int newlength = processor.getLength();
+    float historyDifference = 0.0f;
+    for(int a = 0; a < newlength; a++) {
+        const double moment = static_cast<double>(a) * newdTms;
+        double end = 0.0, value = 0.0;
+        int age = 0;
+        while(age < length - 1 && end + times[times.size() - 1 - age] <= moment)
+            end += times[times.size() - 1 - age++];
+        if(age < length - 1) {
+            const double w = (moment - end) / times[times.size() - 1 - age];
+            value = (1.0 - w) * history[length - 1 - age] + w * history[length - 2 - age];
+        }
+        historyDifference = std::max(historyDifference, static_cast<float>(std::abs(processor.getWindow()[newlength - 1 - a] - value)));
+    }
+    processor.computeFrequency();
+    const float after = processor.getFrequency();
+
+    // Filter memory decays and the centering window is refilled long before the record is replaced by new counts,
+    // warm-up of the fresh processor leaves its record a bit later, since the second record both processors
+    // should give the same results up to rounding of the running sums
+    vpg::PulseProcessor fresh(Tovms, Tcnms, Tlpfms, newdTms, vpg::PulseProcessor::HeartRate);
+    float signalDifference = 0.0f, frequencyDifference = 0.0f;
+    for(int i = 0; i < 4 * newlength; i++) {
+        const float time = newdTms + static_cast<float>(std::rand() % 5) - 2.0f;
+        t += time / 1000.0f;
+        const float value = count(t);
+        processor.update(value, time);
+        fresh.update(value, time);
+        if(i >= 2 * newlength) {
+            signalDifference = std::max(signalDifference, std::abs(processor.getSignalSampleValue() - fresh.getSignalSampleValue()));
+            if(i % 10 == 0) {
+                processor.computeFrequency();
+                fresh.computeFrequency();
+                frequencyDifference = std::max(frequencyDifference, std::abs(processor.getEstimate().frequency - fresh.getEstimate().frequency));
+                frequencyDifference = std::max(frequencyDifference, std::abs(processor.getEstimate().snr - fresh.getEstimate().snr));
+            }
+        }
+    }
+    std::cout << "record of " << length << " counts is resampled to " << newlength << " counts, estimation " << before << " bpm before and "
+              << after << " bpm after reconfiguration" << std::endl
+              << "max difference of resampled history " << historyDifference << ", of signal after refill " << signalDifference
+              << ", of frequency and snr " << frequencyDifference << std::endl;
+    const float historyTolerance = 1e-5f, continuityTolerance = 1.0f, signalTolerance = 1e-4f, frequencyTolerance = 1e-3f;
+    if(historyDifference > historyTolerance || std::abs(after - before) > continuityTolerance
+            || signalDifference > signalTolerance || frequencyDifference > frequencyTolerance) {
+        std::cout << "Reconfigured processor differs from the reference! Abort..." << std::endl;
+        return 1;
+    }
+    std::cout << "Test passed" << std::endl;
+    return 0;
+}
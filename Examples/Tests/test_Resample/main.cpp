@@ -0,0 +1,67 @@
+#include <iostream>
+#include <cmath>
+#include <cstdlib>
+#include "vpg.h"
+
+int main(int argc, char *argv[])
+{
+    std::cout << "Run resampling test:" << std::endl;
+
+    // Resampling processor picks the length of fast DFT, reference is the plain processor of the internal grid period
+    const float dTms = 33.0f, Tovms = 7500.0f, Tcnms = 400.0f, Tlpfms = 350.0f;
+    const int counts = argc > 1 ? std::atoi(argv[1]) : 10000;
+    vpg::PulseProcessor resampling(Tovms, Tcnms, Tlpfms, dTms, vpg::PulseProcessor::HeartRate, true);
+    const float gridms = Tovms / resampling.getLength();
+    vpg::PulseProcessor reference(Tovms, Tcnms, Tlpfms, gridms, vpg::PulseProcessor::HeartRate, false);
+    std::cout << "input period " << dTms << " ms, internal grid " << gridms << " ms, record of " << resampling.getLength() << " counts" << std::endl;
+    if(reference.getLength() != resampling.getLength()) {
+        std::cout << "Reference has length " << reference.getLength() << "! Abort..." << std::endl;
+        return 1;
+    }
+
+    // Reference interpolates counts linearly at the moments of the grid, which starts at the first count,
+    // both spectrums are computed by full DFT, so only rounding of the grid phase differs
+    const float signalTolerance = 1e-3f, frequencyTolerance = 1e-2f, snrTolerance = 1e-2f;
+    float signalDifference = 0.0f, frequencyDifference = 0.0f, snrDifference = 0.0f;
+    double previousTime = 0.0, grid = 0.0;
+    float previousValue = 0.0f;
+    int gridcounts = 0;
+    std::srand(5);
+    float t = 0.0f;
+    for(int i = 0; i < counts; i++) {
+        const float time = dTms + static_cast<float>(std::rand() % 13) - 6.0f;
+        t += time / 1000.0f;
+        const float value = 90.0f + std::sin(2.0f * 3.14159265f * 1.3f * t) + 0.4f * std::sin(2.0f * 3.14159265f * 0.3f * t)
+                            + static_cast<float>(std::rand() % 1000) / 4000.0f;
+        resampling.update(value, time);
+        if(i == 0) {
+            reference.update(value, gridms);
+            grid = gridms;
+            gridcounts++;
+        } else {
+            const double currentTime = previousTime + time;
+            for(; grid <= currentTime; grid += gridms, gridcounts++)
+                reference.update(static_cast<float>(previousValue + (value - previousValue) * (grid - previousTime) / time), gridms);
+            previousTime = currentTime;
+        }
+        previousValue = value;
+        signalDifference = std::max(signalDifference, std::abs(reference.getSignalSampleValue() - resampling.getSignalSampleValue()));
+
+        if(i % 10 == 0 && gridcounts >= reference.getLength()) {
+            resampling.computeFrequency();
+            reference.computeFrequency();
+            frequencyDifference = std::max(frequencyDifference, std::abs(resampling.getEstimate().frequency - reference.getEstimate().frequency));
+            snrDifference = std::max(snrDifference, std::abs(resampling.getEstimate().snr - reference.getEstimate().snr));
+        }
+    }
+    std::cout << counts << " counts, " << gridcounts << " grid counts, last estimation " << resampling.getFrequency() << " bpm by resampling and "
+              << reference.getFrequency() << " bpm by reference" << std::endl
+              << "max difference of signal " << signalDifference << ", of frequency " << frequencyDifference
+              << " bpm, of snr " << snrDifference << " dB" << std::endl;
+    if(signalDifference > signalTolerance || frequencyDifference > frequencyTolerance || snrDifference > snrTolerance) {
+        std::cout << "Resampling differs from the reference interpolation! Abort..." << std::endl;
+        return 1;
+    }
+    std::cout << "Test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,13 @@
+
+CONFIG += c++11
+TARGET = test_Resample
+CONFIG += console
+CONFIG -= app_bundle
+CONFIG -= qt
+
+TEMPLATE = app
+
+SOURCES += main.cpp
+
+include($${PWD}/../../../Shared/vpglib.pri)
+
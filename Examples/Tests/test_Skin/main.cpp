@@ -0,0 +1,45 @@
+#include <iostream>
+#include "vpg.h"
+
+// Original form of the RGB rule that FaceProcessor used before the lookup table
+static bool skinColor(unsigned char vR, unsigned char vG, unsigned char vB)
+{
+    return (vR > 95) && (vR > vG) && (vG > 40) && (vB > 20) && ((vR - std::min(vG,vB)) > 5) && ((vR - vG) > 5);
+}
+
+int main()
+{
+    std::cout << "Run skin rule sweep test:" << std::endl;
+
+    // Each color is alone in the block of 16 black pixels, so vectorized kernel gives the mask of this color,
+    // position in the block goes through all lanes
+    const vpg::SkinClassifier classifier(vpg::SkinClassifier::RGB);
+    unsigned char block[3*16] = {0};
+    unsigned long skin = 0, mismatches = 0;
+    for(int r = 0; r < 256; r++)
+        for(int g = 0; g < 256; g++)
+            for(int b = 0; b < 256; b++) {
+                const int lane = b & 15;
+                block[3*lane] = static_cast<unsigned char>(b);
+                block[3*lane+1] = static_cast<unsigned char>(g);
+                block[3*lane+2] = static_cast<unsigned char>(r);
+                unsigned int area = 0, green = 0;
+                vpg::accumulateSkinRow(block, 0, 16, area, green);
+                block[3*lane] = block[3*lane+1] = block[3*lane+2] = 0;
+
+                const bool reference = skinColor(static_cast<unsigned char>(r), static_cast<unsigned char>(g), static_cast<unsigned char>(b));
+                const bool table = classifier.isSkin(static_cast<unsigned char>(r), static_cast<unsigned char>(g), static_cast<unsigned char>(b));
+                if(area != static_cast<unsigned int>(reference) || green != (reference ? static_cast<unsigned int>(g) : 0u) || table != reference) {
+                    if(mismatches++ < 10)
+                        std::cout << "R " << r << ", G " << g << ", B " << b << ": rule " << reference << ", table " << table << ", kernel " << area << std::endl;
+                }
+                skin += reference;
+            }
+    std::cout << skin << " of 16777216 colors are skin, " << mismatches << " mismatches" << std::endl;
+    if(mismatches > 0) {
+        std::cout << "Skin masks differ! Abort..." << std::endl;
+        return 1;
+    }
+    std::cout << "Test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include <iostream>
+#include <cmath>
+#include <deque>
+#include <cstdlib>
+#include "vpg.h"
+
+int main(int argc, char *argv[])
+{
+    std::cout << "Run sliding spectrum test:" << std::endl;
+
+    // Default heart rate geometry, centering window and filter lengths are computed as PulseProcessor does
+    const float dTms = 33.0f, Tcnms = 400.0f, Tlpfms = 350.0f;
+    const int counts = argc > 1 ? std::atoi(argv[1]) : 20000;
+    const int interval = static_cast<int>(Tcnms / dTms), filterlength = static_cast<int>(Tlpfms / dTms);
+    vpg::PulseProcessor full(dTms), sliding(dTms);
+    sliding.setSlidingSpectrum(true);
+
+    // Reference normalization recomputes mean and deviation of the centering window and the filter sum on each count
+    std::deque<double> raw(sliding.getLength(), 0.0), X;
+    for(int i = 0; i < filterlength; i++)
+        X.push_back(i);
+    double Y = 0.0;
+
+    // Running sums are anchored once per record, so their error stays at the float rounding level,
+    // sliding bins are anchored by full DFT once per record too
+    const float signalTolerance = 1e-4f, frequencyTolerance = 1e-3f, snrTolerance = 1e-3f;
+    float signalDifference = 0.0f, frequencyDifference = 0.0f, snrDifference = 0.0f;
+    std::srand(11);
+    float t = 0.0f;
+    for(int i = 0; i < counts; i++) {
+        // Pulse which rate drifts from 60 to 100 bpm and back, breathing, noise and frame time jitter
+        const float time = dTms + static_cast<float>(std::rand() % 9) - 4.0f;
+        t += time / 1000.0f;
+        const float rate = 80.0f + 20.0f * std::sin(2.0f * 3.14159265f * t / 120.0f);
+        const float value = 120.0f + std::sin(2.0f * 3.14159265f * rate / 60.0f * t) + 0.5f * std::sin(2.0f * 3.14159265f * 0.2f * t)
+                            + static_cast<float>(std::rand() % 1000) / 2000.0f;
+        full.update(value, time);
+        sliding.update(value, time);
+
+        raw.pop_front();
+        raw.push_back(value);
+        double mean = 0.0, sko = 0.0;
+        for(int k = 0; k < interval; k++)
+            mean += raw[raw.size() - 1 - k];
+        mean /= interval;
+        for(int k = 0; k < interval; k++)
+            sko += (raw[raw.size() - 1 - k] - mean) * (raw[raw.size() - 1 - k] - mean);
+        sko = std::sqrt(sko / (interval - 1));
+        if(sko < 0.01)
+            sko = 1.0;
+        X.pop_front();
+        X.push_back((value - mean) / sko);
+        double integral = 0.0;
+        for(int k = 0; k < filterlength; k++)
+            integral += X[k];
+        Y = (integral + Y) / (filterlength + 1.0);
+        signalDifference = std::max(signalDifference, static_cast<float>(std::abs(sliding.getSignalSampleValue() - Y)));
+
+        if(i % 5 == 0 && i >= sliding.getLength()) {
+            full.computeFrequency();
+            sliding.computeFrequency();
+            frequencyDifference = std::max(frequencyDifference, std::abs(full.getEstimate().frequency - sliding.getEstimate().frequency));
+            snrDifference = std::max(snrDifference, std::abs(full.getEstimate().snr - sliding.getEstimate().snr));
+        }
+    }
+    std::cout << counts << " counts, last estimation " << full.getFrequency() << " bpm by full DFT and " << sliding.getFrequency() << " bpm by sliding one" << std::endl
+              << "max difference of normalized signal " << signalDifference << ", of frequency " << frequencyDifference
+              << " bpm, of snr " << snrDifference << " dB" << std::endl;
+    if(signalDifference > signalTolerance || frequencyDifference > frequencyTolerance || snrDifference > snrTolerance) {
+        std::cout << "Sliding spectrum differs from the full recomputation! Abort..." << std::endl;
+        return 1;
+    }
+    std::cout << "Test passed" << std::endl;
+    return 0;
+}
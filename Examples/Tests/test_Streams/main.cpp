@@ -0,0 +1,68 @@
+#include <iostream>
+#include <atomic>
+#include "vpg.h"
+
+int main(int argc, char *argv[])
+{
+    std::cout << "Run thread pool and stream manager test:" << std::endl;
+
+    // Tasks that submit other tasks from the workers should all be executed before wait() returns
+    vpg::ThreadPool pool(4);
+    std::atomic<int> executed(0);
+    for(int i = 0; i < 1000; i++)
+        pool.submit([&pool, &executed] {
+            executed++;
+            for(int j = 0; j < 3; j++)
+                pool.submit([&executed] { executed++; });
+        });
+    pool.wait();
+    std::cout << "Pool executed " << executed << " tasks of 4000" << std::endl;
+    if(executed != 4000) {
+        std::cout << "Tasks are lost! Abort..." << std::endl;
+        return 1;
+    }
+
+    // Queues are long enough to keep all frames, so each processed frame should be the next one of its stream
+    const int streams = 8, frames = 200, removed = 2;
+    vpg::StreamManager manager(argc > 1 ? argv[1] : "haarcascade_frontalface_alt2.xml", 4);
+    std::vector<int> ids(streams);
+    std::vector<unsigned long> lastFrames(streams, 0);
+    for(int s = 0; s < streams; s++)
+        ids[s] = manager.addStream(33.0f, 1000.0f, frames);
+    cv::Mat frame(48, 64, CV_8UC3);
+    vpg::StreamResult result;
+    for(int n = 0; n < frames; n++) {
+        for(int s = 0; s < streams; s++) {
+            frame.setTo(cv::Scalar(n % 256, (n + s) % 256, 128));
+            if(manager.pushFrame(ids[s], frame, 33.0f) != (n < frames / 2 || s >= removed)) {
+                std::cout << "Frame is accepted by the removed stream or rejected by the active one! Abort..." << std::endl;
+                return 1;
+            }
+            if(manager.getResult(ids[s], result)) {
+                if(result.frames != result.lastFrame || result.lastFrame < lastFrames[s]) {
+                    std::cout << "Frames of stream " << s << " are processed out of order! Abort..." << std::endl;
+                    return 1;
+                }
+                lastFrames[s] = result.lastFrame;
+            }
+        }
+        // Streams are removed while their frames are processed
+        if(n == frames / 2 - 1)
+            for(int s = 0; s < removed; s++)
+                if(!manager.removeStream(ids[s]) || manager.getResult(ids[s], result)) {
+                    std::cout << "Stream " << s << " is not removed! Abort..." << std::endl;
+                    return 1;
+                }
+    }
+    manager.wait();
+    for(int s = removed; s < streams; s++) {
+        manager.getResult(ids[s], result);
+        if(result.frames != static_cast<unsigned long>(frames) || result.lastFrame != static_cast<unsigned long>(frames)) {
+            std::cout << "Stream " << s << " has processed " << result.frames << " frames of " << frames << "! Abort..." << std::endl;
+            return 1;
+        }
+    }
+    std::cout << "Streams left: " << manager.streams() << " of " << streams << std::endl;
+    std::cout << "Test passed" << std::endl;
+    return manager.streams() == static_cast<size_t>(streams - removed) ? 0 : 1;
+}
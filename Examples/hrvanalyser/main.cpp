@@ -32,10 +32,10 @@ int main(int argc, char *argv[])
         return 2;
     }
 
-    // Now we should measure frame rate of the video
-    std::cout << "Measuring actual frame period. Please wait... " << std::endl;
-    float framePeriod = faceproc.measureFramePeriod(&capture); // ms
-    std::cout << "  frame period: " << framePeriod << " ms" << std::endl;
+    // Frame period of the video file is known, for the video device it will be refined while frames are processed
+    const double _fps = capture.get(cv::CAP_PROP_FPS);
+    vpg::FramePeriodEstimator periodestimator(_fps > 0.0 ? static_cast<float>(1000.0 / _fps) : 33.0f);
+    float framePeriod = periodestimator.getPeriod(); // ms
 
     // Let's create instance of PulseProcessor (it analyzes counts of skin reflection and computes heart rate by means on FFT analysis)
     vpg::PulseProcessor pulseproc(framePeriod);
@@ -68,6 +68,12 @@ int main(int argc, char *argv[])
     while(true) {
         if(capture.read(frame)) {
 
+            if(argc == 1 && periodestimator.update(&capture)) {
+                pulseproc.setSamplingPeriod(periodestimator.getPeriod());
+                signal = pulseproc.getSignal();
+                length = pulseproc.getLength();
+            }
+
             // Essential part for the PPG signal extraction, only 2 strings should be called for the each new frame
             faceproc.enrollImage(frame, s, t);
             if(argc > 1)
@@ -114,7 +120,8 @@ int main(int argc, char *argv[])
                     cv::line(frame, cv::Point2f(xorigin + i*xstep, yorigin - (float)signal[i]*ystep), cv::Point2f(xorigin + (i+1)*xstep, yorigin - (float)signal[(i+1)]*ystep),cv::Scalar(0,200,0),1,cv::LINE_AA);
 
                 // Draw binary-signal from PeakDetector
-                for(int i = 0; i < length-1; i++)
+                xstep = (float)(frame.cols - xorigin*2.0f) / (peakdetector.getSignalLength() - 1);
+                for(int i = 0; i < peakdetector.getSignalLength()-1; i++)
                     cv::line(frame, cv::Point2f(xorigin + i*xstep, yorigin - (float)binarysignal[i]*ystep), cv::Point2f(xorigin + (i+1)*xstep, yorigin - (float)binarysignal[(i+1)]*ystep),cv::Scalar(0,0,255),1,cv::LINE_AA);
 
                 // Draw frame time
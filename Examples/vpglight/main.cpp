@@ -29,6 +29,9 @@ int main(int argc, char *argv[])
 {
     float measInt_ms = 1000.0f;
     int deviceID = 0;
+    int detectionPeriod = 1;
+    bool asyncDetection = false;
+    bool pipelined = false;
     char *outputHRfilename = 0;
     char *outputVPGfilename = 0;
     char *outputVideofilename = 0;
@@ -54,6 +57,15 @@ int main(int argc, char *argv[])
             case 'w':
                 outputVideofilename = ++argv[0];
                 break;
+            case 'd':
+                detectionPeriod = str2num<int>(++argv[0]);
+                break;
+            case 'a':
+                asyncDetection = true;
+                break;
+            case 'p':
+                pipelined = true;
+                break;
             case 'h':
                 std::cout << APP_NAME << " v" << APP_VERSION << " help" << std::endl << std::endl
                           << " -v[int] - video device enumerator (default " << deviceID << ")" << std::endl
@@ -62,6 +74,9 @@ int main(int argc, char *argv[])
                           << " -o[str] - output file with the HR vs time" << std::endl
                           << " -s[str] - output file with the VPG counts vs frame number" << std::endl
                           << " -w[str] - output video file name" << std::endl
+                          << " -d[int] - face detection period in frames, face is tracked in between (default " << detectionPeriod << ")" << std::endl
+                          << " -a - detect face on the background thread" << std::endl
+                          << " -p - run capture, face processing and pulse processing on the separate threads" << std::endl
                           << " -h - help :)" << std::endl << std::endl
                           << APP_DESIGNER << std::endl;
                 return 0;
@@ -110,11 +125,16 @@ int main(int argc, char *argv[])
     #else
     vpg::FaceProcessor faceproc(std::string("haarcascade_frontalface_alt2.xml"));
     #endif
+    faceproc.setDetectionPeriod(static_cast<unsigned int>(std::max(1, detectionPeriod)));
+    faceproc.setAsyncDetection(asyncDetection);
 
-    std::cout << "Measuring frame period. PLease wait..." << std::endl;
-    double framePeriod = faceproc.measureFramePeriod(&capture); // milliseconds
-    std::cout << framePeriod << " ms" << std::endl;
+    // Processing starts from the first frame, frame period of the video device is refined on the fly
+    const double _fps = capture.get(cv::CAP_PROP_FPS);
+    vpg::FramePeriodEstimator periodestimator(_fps > 0.0 ? static_cast<float>(1000.0 / _fps) : 33.0f);
+    double framePeriod = periodestimator.getPeriod(); // milliseconds
     vpg::PulseProcessor pulseproc(framePeriod);
+    pulseproc.setProgressiveEstimation(true); // first estimate after about 2 s instead of the whole record
+    pulseproc.setAsyncEstimation(true); // spectrum is computed on the background thread, so frames do not wait for it
 
     cv::VideoWriter videowriter;
     if(outputVideofilename)
@@ -156,13 +176,38 @@ int main(int argc, char *argv[])
               << "Frame;\tVPG[c.n.];\tHR[bpm];\tSNR[db]" << std::endl;
     }
 
-    faceproc.dropTimer();
+    vpg::VideoPipeline pipeline(&capture, &faceproc, &pulseproc, measInt_ms, inputVideofilename ? static_cast<float>(framePeriod) : 0.0f);
+    vpg::PipelineFrame processed;
+    float sample = 0.0f;
+    bool measured = false;
+    if(pipelined)
+        pipeline.start();
+    else
+        faceproc.dropTimer();
     while(true) {
-        if(capture.read(frame)) {
-
-            if(videowriter.isOpened())
-                videowriter.write(frame);
-
+        if(pipelined) {
+            // Stages run on their own threads, here processed frames are only rendered
+            if(pipeline.pop(processed) == false) {
+                if(pipeline.finished())
+                    break;
+                if((char)cv::waitKey(1) == 27)
+                    break;
+                continue;
+            }
+            frame = processed.image;
+            s = processed.value;
+            t = processed.time;
+            faceRect = processed.faceRect;
+            vS = processed.signal.data();
+            length = static_cast<int>(processed.signal.size());
+            sample = processed.sample;
+            measured = processed.measured;
+        } else if(capture.read(frame)) {
+            if(!inputVideofilename && periodestimator.update(&capture)) {
+                pulseproc.setSamplingPeriod(periodestimator.getPeriod());
+                length = pulseproc.getLength();
+                vS = pulseproc.getSignal();
+            }
             faceproc.enrollImage(frame, s, t);
             if(inputVideofilename) {
                 pulseproc.update(s,framePeriod);
@@ -170,66 +215,73 @@ int main(int argc, char *argv[])
                 pulseproc.update(s,t);
             }
             faceRect = faceproc.getFaceRect();
+            sample = pulseproc.getSignalSampleValue();
+            if(inputVideofilename) {
+                timeout -= framePeriod; // if videofile is used as source then we should use knowing frame period
+            } else {
+                timeout -= t;
+            }
+            measured = timeout < 0.0;
+            if(measured) {
+                pulseproc.computeFrequency();
+                timeout = measInt_ms;
+            }
+        } else {
+            break; // stop processing when frame can not be read
+        }
 
-            if(faceRect.area() > 0) {
+        if(videowriter.isOpened())
+            videowriter.write(frame);
 
-                float shiftX = frame.cols * 0.1f;
-                float stepX = static_cast<float>(frame.cols - 2*shiftX) / length;
-                float stepY = 0.025f * frame.rows;
-                float shiftY = 0.9f * frame.rows;
+        if(faceRect.area() > 0) {
 
-                for(int i = 0; i < length - 1; i++) {
-                    p1 = cv::Point2f(shiftX + stepX * i, shiftY + stepY * vS[i]);
-                    p2 = cv::Point2f(shiftX + stepX * (i + 1), shiftY + stepY * vS[i + 1]);
-                    cv::line(frame, p1, p2, cv::Scalar(0,255,0), 1, cv::LINE_AA);
-                }
+            float shiftX = frame.cols * 0.1f;
+            float stepX = static_cast<float>(frame.cols - 2*shiftX) / length;
+            float stepY = 0.025f * frame.rows;
+            float shiftY = 0.9f * frame.rows;
 
-                cv::rectangle(frame,faceproc.getFaceRect(),cv::Scalar(0,0,0), 1, cv::LINE_AA);
-                cv::rectangle(frame,faceproc.getFaceRect()-cv::Point(1,1),cv::Scalar(255,255,255), 1, cv::LINE_AA);
+            for(int i = 0; i < length - 1; i++) {
+                p1 = cv::Point2f(shiftX + stepX * i, shiftY + stepY * vS[i]);
+                p2 = cv::Point2f(shiftX + stepX * (i + 1), shiftY + stepY * vS[i + 1]);
+                cv::line(frame, p1, p2, cv::Scalar(0,255,0), 1, cv::LINE_AA);
+            }
 
-                cv::putText(frame, "HR [bpm]:", cv::Point(11, 31), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0,0,0), 1, cv::LINE_AA);
-                cv::putText(frame, "HR [bpm]:", cv::Point(10, 30), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255,255,255), 1, cv::LINE_AA);
+            cv::rectangle(frame,faceRect,cv::Scalar(0,0,0), 1, cv::LINE_AA);
+            cv::rectangle(frame,faceRect-cv::Point(1,1),cv::Scalar(255,255,255), 1, cv::LINE_AA);
 
-                std::string _freqstr = num2str(frequency);
-                cv::putText(frame, _freqstr, cv::Point(101, 35), cv::FONT_HERSHEY_SIMPLEX, 1.2, cv::Scalar(0,0,0), 1, cv::LINE_AA);
-                cv::putText(frame, _freqstr, cv::Point(100, 34), cv::FONT_HERSHEY_SIMPLEX, 1.2, ( frequency > 65 && frequency < 85) ? cv::Scalar(0,230,0) : cv::Scalar(0,0,230), 1, cv::LINE_AA);
+            cv::putText(frame, "HR [bpm]:", cv::Point(11, 31), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0,0,0), 1, cv::LINE_AA);
+            cv::putText(frame, "HR [bpm]:", cv::Point(10, 30), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255,255,255), 1, cv::LINE_AA);
 
-                std::string _snrstr = "snr: " + num2str(snr,2) + " dB";
-                cv::putText(frame, _snrstr, cv::Point(11, 61), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0,0,0), 1, cv::LINE_AA);
-                cv::putText(frame, _snrstr, cv::Point(10, 60), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255,255,255), 1, cv::LINE_AA);
-            }
-            cv::putText(frame, num2str(t,1) + " ms, press ESC to exit or 's' to get DirectShow settings", cv::Point(11, frame.rows - 10), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0,0,0), 1, cv::LINE_AA);
-            cv::putText(frame, num2str(t,1) + " ms, press ESC to exit or 's' to get DirectShow settings", cv::Point(10, frame.rows - 11), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255,255,255), 1, cv::LINE_AA);
+            std::string _freqstr = num2str(frequency);
+            cv::putText(frame, _freqstr, cv::Point(101, 35), cv::FONT_HERSHEY_SIMPLEX, 1.2, cv::Scalar(0,0,0), 1, cv::LINE_AA);
+            cv::putText(frame, _freqstr, cv::Point(100, 34), cv::FONT_HERSHEY_SIMPLEX, 1.2, ( frequency > 65 && frequency < 85) ? cv::Scalar(0,230,0) : cv::Scalar(0,0,230), 1, cv::LINE_AA);
 
-            cv::namedWindow(APP_NAME, cv::WINDOW_NORMAL);
-            cv::imshow(APP_NAME, frame);
-        } else {
-            break; // stop processing when frame can not be read
+            std::string _snrstr = "snr: " + num2str(snr,2) + " dB";
+            cv::putText(frame, _snrstr, cv::Point(11, 61), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0,0,0), 1, cv::LINE_AA);
+            cv::putText(frame, _snrstr, cv::Point(10, 60), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255,255,255), 1, cv::LINE_AA);
         }
+        cv::putText(frame, num2str(t,1) + " ms, press ESC to exit or 's' to get DirectShow settings", cv::Point(11, frame.rows - 10), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0,0,0), 1, cv::LINE_AA);
+        cv::putText(frame, num2str(t,1) + " ms, press ESC to exit or 's' to get DirectShow settings", cv::Point(10, frame.rows - 11), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255,255,255), 1, cv::LINE_AA);
 
-        if(inputVideofilename) {
-            timeout -= framePeriod; // if videofile is used as source then we should use knowing frame period
-        } else {
-            timeout -= t;
-        }
+        cv::namedWindow(APP_NAME, cv::WINDOW_NORMAL);
+        cv::imshow(APP_NAME, frame);
 
-        if(timeout < 0.0) {
+        if(measured) {
+            const float _frequency = pipelined ? processed.frequency : pulseproc.getFrequency();
             if(frequency == 0 || measInt_ms > 2000.0) {
-                frequency = static_cast<unsigned int>(pulseproc.computeFrequency());
+                frequency = static_cast<unsigned int>(_frequency);
             } else {
-                frequency = (frequency + static_cast<unsigned int>(pulseproc.computeFrequency()))/2;
+                frequency = (frequency + static_cast<unsigned int>(_frequency))/2;
             }
-            snr = pulseproc.getSNR();
+            snr = pipelined ? processed.snr : pulseproc.getSNR();
 
             if(ohrfs.is_open())
                 ohrfs << frequency << ";\t" << std::setprecision(2) << snr << std::endl;
-
-            timeout = measInt_ms;
         }
 
         if(ovpgfs.is_open()) {
             ovpgfs << framecounter
-                   << std::setprecision(3) << ";\t" << pulseproc.getSignalSampleValue()
+                   << std::setprecision(3) << ";\t" << sample
                    << ";\t" << frequency
                    << std::setprecision(2) << ";\t" << snr
                    << std::endl;
@@ -247,6 +299,16 @@ int main(int argc, char *argv[])
         framecounter++;
     }
 
+    if(pipelined) {
+        pipeline.stop();
+        const char *_stages[] = {"capture", "enroll", "pulse"};
+        for(int i = 0; i < 3; i++) {
+            vpg::StageStats _stats = pipeline.getStats(static_cast<vpg::VideoPipeline::Stage>(i));
+            std::cout << _stages[i] << ": " << _stats.processed << " frames, " << _stats.dropped << " dropped, "
+                      << _stats.averageLatency << " ms average, " << _stats.maxLatency << " ms max, "
+                      << _stats.queueDepth << " queued" << std::endl;
+        }
+    }
     capture.release();
 
     if(videowriter.isOpened())
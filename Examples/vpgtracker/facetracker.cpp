@@ -537,29 +537,18 @@ cv::Rect FaceTracker::__getAverageFaceRect() const
 //---------------------------------------------------------------------------------
 bool FaceTracker::isSkinColor(const uchar vR, const uchar vG, const uchar vB)
 {
-    if( (vR > 95) && (vR > vG) && (vG > 40) && (vB > 20) &&
-        ((vR - std::min(vG,vB)) > 5) && ((vR - vG) > 5 ) )
-        return true;
-    else
-        return false;
+    return skinClassifier().isSkin(vR, vG, vB);
 }
 //---------------------------------------------------------------------------------
 void FaceTracker::threshSkin(const cv::Mat &inputArray, cv::Mat &outputArray, uchar minVal, uchar maxVal)
 {
-    outputArray = cv::Mat(inputArray.rows, inputArray.cols, CV_8UC1);
-    uchar *p_output;
-    const uchar *p_input;
-    #pragma omp parallel for private(p_output, p_input)
-    for(int y = 0; y < inputArray.rows; y++) {
-        p_input = inputArray.ptr<const uchar>(y);
-        p_output = outputArray.ptr(y);
-        for(int x = 0; x < inputArray.cols; x++) {
-            if(isSkinColor(p_input[x*3+2], p_input[x*3+1], p_input[x*3]))
-                p_output[x] = maxVal;
-            else
-                p_output[x] = minVal;
-        }
-    }
+    skinClassifier().threshold(inputArray, outputArray, minVal, maxVal);
+}
+//---------------------------------------------------------------------------------
+const vpg::SkinClassifier &FaceTracker::skinClassifier()
+{
+    static const vpg::SkinClassifier _classifier(vpg::SkinClassifier::RGB);
+    return _classifier;
 }
 //---------------------------------------------------------------------------------
 void FaceTracker::resetHistory()
@@ -16,6 +16,8 @@
 
 #include <opencv2/face.hpp>
 
+#include "skinclassifier.h"
+
 class FaceTracker
 {
 public:
@@ -87,6 +89,11 @@ public:
      * @return
      */
     static bool isSkinColor(const uchar vR, const uchar vG, const uchar vB);
+    /**
+     * @brief skinClassifier - lookup table classifier that is used by isSkinColor and threshSkin
+     * @return reference to the classifier instance
+     */
+    static const vpg::SkinClassifier &skinClassifier();
     /**
      * @brief resetHistory resets history vector
      */
@@ -133,16 +133,20 @@ int main(int argc, char *argv[])
     vpg::PeakDetector peakdetfirst(pulseprocfirst.getLength(), totalcardiointervals, 11, framePeriod), peakdetsecond(pulseprocsecond.getLength(), totalcardiointervals, 11, framePeriod);
     pulseprocfirst.setPeakDetector(&peakdetfirst);
     pulseprocsecond.setPeakDetector(&peakdetsecond);
+    // Both spectrums are computed by one call
+    vpg::SpectrumEngine spectrumengine;
+    spectrumengine.add(&pulseprocfirst);
+    spectrumengine.add(&pulseprocsecond);
     std::vector<const float *> _vhrvsignals;
     _vhrvsignals.push_back(peakdetfirst.getIntervalsVector());
     _vhrvsignals.push_back(peakdetsecond.getIntervalsVector());
     // Create local variables to store frame and processing values
     float _hrupdateIntervalms = 0.0;
     float _r = 0.0, _g = 0.0, _b = 0.0, t = 0.0;
-    float _dummytime = 0.0; // it is dummy variable, it is needed because we do not want to modify frame time on the second frame processing call
     std::pair<unsigned int, unsigned int> _hr(pulseprocfirst.getFrequency(),pulseprocsecond.getFrequency());
     std::pair<float, float> _snr(0.0,0.0);
-    float _avgBlue[] = {0,0,0,0}, _avgGreen[] = {0,0,0,0}, _avgRed[] = {0,0,0,0};
+    std::vector<vpg::EnrollRegion> _regions;
+    std::vector<vpg::RegionStats> _regionstats;
 
     cv::Mat frame, faceregion;
     cv::Size targetfacesize(cmdargsparser.get<int>("facesize"), cmdargsparser.get<int>("facesize") * 1.33);
@@ -180,12 +184,18 @@ int main(int argc, char *argv[])
 
         faceregion = facetracker.getResizedFaceImage(frame,targetfacesize);
         if(!faceregion.empty()) {
-           faceproc.enrollFace(faceregion,_avgRed,_avgGreen,_avgBlue,t);
+           // Face quadrants and both selections are enrolled by one pass over the face image
+           _regions = faceproc.getFaceQuadrants(faceregion.size());
+           _regions.push_back(vpg::EnrollRegion(vpg::EnrollRegion::Rectangle, _selectionpair.first));
+           _regions.push_back(vpg::EnrollRegion(vpg::EnrollRegion::Rectangle, _selectionpair.second));
+           faceproc.enrollRegions(faceregion,_regions,_regionstats,t);
            for(unsigned int _part = 0; _part < 4; ++_part) {
-               ofs << _avgRed[_part] << ",\t" << _avgGreen[_part] << ",\t" << _avgBlue[_part] << ",\t";
+               ofs << _regionstats[_part].avgRed << ",\t" << _regionstats[_part].avgGreen << ",\t" << _regionstats[_part].avgBlue << ",\t";
            }
 
-           faceproc.enrollImagePart(faceregion,_r,_g,_b,_dummytime,_selectionpair.first);
+           _r = _regionstats[4].avgRed;
+           _g = _regionstats[4].avgGreen;
+           _b = _regionstats[4].avgBlue;
            ofs << _r << ",\t" << _g << ",\t" << _b << ",\t";
            switch(_colorset) {
                 case 0:
@@ -198,7 +208,9 @@ int main(int argc, char *argv[])
                    pulseprocfirst.update(_b,t);
                    break;
            }
-           faceproc.enrollImagePart(faceregion,_r,_g,_b,_dummytime,_selectionpair.second);
+           _r = _regionstats[5].avgRed;
+           _g = _regionstats[5].avgGreen;
+           _b = _regionstats[5].avgBlue;
            ofs << _r << ",\t" << _g << ",\t" << _b << ",\t";
            switch(_colorset) {
                 case 0:
@@ -213,9 +225,10 @@ int main(int argc, char *argv[])
            }
            _hrupdateIntervalms += t;
            if(_hrupdateIntervalms > 1500.0) {
-               _hr.first = (_hr.first + pulseprocfirst.computeFrequency() + (60000.0 / peakdetfirst.averageCardiointervalms())) / 3.0;
+               spectrumengine.compute();
+               _hr.first = (_hr.first + pulseprocfirst.getFrequency() + (60000.0 / peakdetfirst.averageCardiointervalms())) / 3.0;
                _snr.first = pulseprocfirst.getSNR();
-               _hr.second = (_hr.second + pulseprocsecond.computeFrequency() + (60000.0 / peakdetsecond.averageCardiointervalms())) / 3.0;
+               _hr.second = (_hr.second + pulseprocsecond.getFrequency() + (60000.0 / peakdetsecond.averageCardiointervalms())) / 3.0;
                _snr.second = pulseprocsecond.getSNR();
                _hrupdateIntervalms = 0.0;
            }
@@ -1,4 +1,5 @@
 TEMPLATE = lib
+CONFIG += thread
 
 CONFIG(release, debug|release) {
     TARGET = vpg
@@ -7,16 +8,43 @@ CONFIG(release, debug|release) {
 }
 
 SOURCES += \
+    $${PWD}/src/asyncspectrum.cpp \
     $${PWD}/src/faceprocessor.cpp \
+    $${PWD}/src/frameperiodestimator.cpp \
     $${PWD}/src/hrvprocessor.cpp \
+    $${PWD}/src/multifaceprocessor.cpp \
     $${PWD}/src/peakdetector.cpp \
-    $${PWD}/src/pulseprocessor.cpp
+    $${PWD}/src/pixelkernels.cpp \
+    $${PWD}/src/pulseprocessor.cpp \
+    $${PWD}/src/pulseprocessorbank.cpp \
+    $${PWD}/src/skinclassifier.cpp \
+    $${PWD}/src/slidingspectrum.cpp \
+    $${PWD}/src/spectrumengine.cpp \
+    $${PWD}/src/spectrumestimator.cpp \
+    $${PWD}/src/streammanager.cpp \
+    $${PWD}/src/threadpool.cpp \
+    $${PWD}/src/videopipeline.cpp
 
 HEADERS += \
+    $${PWD}/include/asyncspectrum.h \
     $${PWD}/include/faceprocessor.h \
+    $${PWD}/include/frameperiodestimator.h \
     $${PWD}/include/hrvprocessor.h \
+    $${PWD}/include/multifaceprocessor.h \
     $${PWD}/include/peakdetector.h \
+    $${PWD}/include/pixelkernels.h \
     $${PWD}/include/pulseprocessor.h \
+    $${PWD}/include/pulseprocessorbank.h \
+    $${PWD}/include/ringbuffer.h \
+    $${PWD}/include/skinclassifier.h \
+    $${PWD}/include/slidingspectrum.h \
+    $${PWD}/include/spectrumengine.h \
+    $${PWD}/include/spectrumestimator.h \
+    $${PWD}/include/spscring.h \
+    $${PWD}/include/streammanager.h \
+    $${PWD}/include/threadpool.h \
+    $${PWD}/include/triplebuffer.h \
+    $${PWD}/include/videopipeline.h \
     $${PWD}/include/vpg.h
 
 INCLUDEPATH += $${PWD}/include
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2015, Taranov Alex <pi-null-mezon@yandex.ru>.
+ * Released to public domain under terms of the BSD Simplified license.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the organization nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *   See <http://www.opensource.org/licenses/bsd-license>
+ */
+#ifndef ASYNCSPECTRUM_H
+#define ASYNCSPECTRUM_H
+//-------------------------------------------------------
+#ifdef DLL_BUILD_SETUP
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC __attribute__((visibility("default")))
+    #else
+        #define DLLSPEC __declspec(dllexport)
+    #endif
+#else
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC
+    #else
+        #define DLLSPEC __declspec(dllimport)
+    #endif
+#endif
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "spectrumestimator.h"
+#include "triplebuffer.h"
+//-------------------------------------------------------
+namespace vpg {
+
+/**
+ * @brief The AsyncSpectrum class estimates posted records on the background thread,
+ * worker has own SpectrumEstimator, so the results are the same as for the synchronous estimation
+ * @note record is posted by the swap of two snapshots, so the worker always gets the newest one,
+ * results come back through the triple buffer, so neither side waits for the other
+ */
+#ifndef VPG_BUILD_FROM_SOURCE
+class DLLSPEC AsyncSpectrum
+#else
+class AsyncSpectrum
+#endif
+{
+public:
+    /**
+     * Default constructor, starts the worker
+     */
+    AsyncSpectrum();
+    /**
+     * Destructor, stops the worker, record that has not been taken yet is dropped
+     */
+    ~AsyncSpectrum();
+    /**
+     * @brief post - copy the record and its settings for the worker
+     * @param record - self explained
+     * @param settings - settings of the record, worker reconfigures own estimator only when they change
+     * @param generation - history generation of the record, worker drops own estimations when it changes
+     */
+    void post(const SpectrumRecord &record, const SpectrumSettings &settings, unsigned long generation);
+    /**
+     * @brief take - accept the latest published estimations
+     * @param generation - estimations of other generations are ignored
+     * @param estimator - receives estimations
+     * @return true if estimations have been accepted
+     */
+    bool take(unsigned long generation, SpectrumEstimator &estimator);
+
+private:
+    AsyncSpectrum(const AsyncSpectrum &);
+    AsyncSpectrum &operator=(const AsyncSpectrum &);
+    void __estimationLoop();
+
+    struct Snapshot
+    {
+        Snapshot() : filled(0), generation(0) {}
+        std::vector<float> signal;
+        std::vector<float> time;
+        int filled;
+        SpectrumSettings settings;
+        unsigned long generation;
+    };
+    struct Estimation
+    {
+        Estimation() : generation(0) {}
+        std::vector<PulseEstimate> estimates;
+        unsigned long generation;
+    };
+    bool f_stop;
+    bool f_snapshotpending;
+    std::mutex m_snapshotMutex;
+    std::condition_variable m_snapshotCondition;
+    Snapshot m_postedSnapshot;
+    Snapshot m_pendingSnapshot;
+    TripleBuffer<Estimation> m_publishedEstimation;
+    std::thread m_estimationThread;
+};
+
+}
+//-------------------------------------------------------
+#endif // ASYNCSPECTRUM_H
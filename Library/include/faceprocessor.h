@@ -37,8 +37,69 @@
 #include <opencv2/imgproc.hpp>
 #include <opencv2/imgproc/imgproc_c.h>
 #include <opencv2/highgui.hpp>
+#include "skinclassifier.h"
+#include "triplebuffer.h"
+//-------------------------------------------------------
+#include <climits>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 //-------------------------------------------------------
 namespace vpg {
+
+/**
+ * @brief downscaleForDetection - shrink frames bigger than 640x480 to the size the face detector is tuned for
+ * @param rgbImage - input image
+ * @param img - output image, it shares data with rgbImage if no resize is needed
+ * @param scaleX - how to scale horizontal coordinates of img to get rgbImage's ones
+ * @param scaleY - how to scale vertical coordinates of img to get rgbImage's ones
+ */
+DLLSPEC void downscaleForDetection(const cv::Mat &rgbImage, cv::Mat &img, float &scaleX, float &scaleY);
+
+/**
+ * @brief The EnrollRegion struct describes one image area for FaceProcessor::enrollRegions
+ */
+struct EnrollRegion
+{
+    enum Shape {Rectangle, Ellipse, Polygon};
+    /**
+     * Constructor for Rectangle and Ellipse shapes
+     * @param shape - self explained
+     * @param rect - region rect or bounding rect of the ellipse, empty Rectangle means whole image
+     * @param clip - only pixels inside clip will be counted
+     * @param minarea - if region area is not greater than minarea zero average colors will be returned
+     */
+    EnrollRegion(Shape shape=Rectangle, const cv::Rect &rect=cv::Rect(), const cv::Rect &clip=cv::Rect(0,0,INT_MAX,INT_MAX), unsigned long minarea=16) :
+        shape(shape), rect(rect), clip(clip), minarea(minarea) {}
+    /**
+     * Constructor for Polygon shape
+     * @param polygon - vertices of the polygon
+     * @param minarea - if region area is not greater than minarea zero average colors will be returned
+     */
+    EnrollRegion(const std::vector<cv::Point> &polygon, unsigned long minarea=16) :
+        shape(Polygon), clip(0,0,INT_MAX,INT_MAX), polygon(polygon), minarea(minarea) {}
+
+    Shape shape;
+    cv::Rect rect;
+    cv::Rect clip;
+    std::vector<cv::Point> polygon;
+    unsigned long minarea;
+};
+
+/**
+ * @brief The RegionStats struct stores result of FaceProcessor::enrollRegions for one region
+ */
+struct RegionStats
+{
+    unsigned long red;
+    unsigned long green;
+    unsigned long blue;
+    unsigned long area;
+    float avgRed;
+    float avgGreen;
+    float avgBlue;
+};
 	
 /**
  * @brief The FaceProcessor class should be used for PPG signal counts mining from the face video
@@ -95,6 +156,37 @@ public:
      * @note  no face detection will be performed! It is your responsibility to provide face image
      */
     void enrollFace(const cv::Mat &rgbImage, float *v_resRed, float *v_resGreen, float *v_resBlue, float &resT);
+    /**
+     * Extract color sums and average colors from the several regions by single pass over the image
+     * @param rgbImage - input image, BGR format only
+     * @param regions - regions to process, they could overlap
+     * @param v_stats - output vector, one element per region in the same order
+     * @param resT - where processing time should be written
+     * @note  no face detection will be performed!
+     */
+    void enrollRegions(const cv::Mat &rgbImage, const std::vector<EnrollRegion> &regions, std::vector<RegionStats> &v_stats, float &resT);
+    /**
+     * Get 4-part face partition that is used by enrollFace, it could be extended by other regions and passed to enrollRegions
+     * @param faceSize - size of the face image
+     * @return 4 regions in the same order as enrollFace outputs
+     */
+    std::vector<EnrollRegion> getFaceQuadrants(const cv::Size &faceSize) const;
+    /**
+     * Build summed-area table of the image, after that each enrollIntegralPart call costs O(1) regardless of roi size
+     * @param rgbImage - input image, BGR format only
+     * @note  table buffer is reused while frame size stays the same, call once per frame when many rois are queried
+     */
+    void buildIntegral(const cv::Mat &rgbImage);
+    /**
+     * Enroll roi rect of the image that has been passed to the last buildIntegral call
+     * @param resRed - where result count should be written (red channel)
+     * @param resGreen - where result count should be written (green channel)
+     * @param resBlue - where result count should be written (blue channel)
+     * @param resT - where processing time should be written
+     * @param roirect - rect of interest, empty rect means whole image
+     * @note  results are equal to enrollImagePart ones for the same image and roi
+     */
+    void enrollIntegralPart(float &resRed, float &resGreen, float &resBlue, float &resT, cv::Rect roirect=cv::Rect());
     /**
      * Get cv::Rect that bounds face on image
      * @return coordinates of face on image in cv::Rect form
@@ -111,6 +203,7 @@ public:
      * @param _vcptr - pointe rto the target video capture (that will be used to VPG extraction)
      * @return average frame time in ms (use this value to instantiate PulseProcessor instance then)
      * @note VideoCapture object should be opened else -1.0 will be returned
+     * @note blocks while 35 frames are processed, FramePeriodEstimator gives estimation from the capture timestamps without warm-up
      */
     float measureFramePeriod(cv::VideoCapture *_vcptr);
     /**
@@ -122,32 +215,134 @@ public:
      * @return self explained
      */
     bool empty();
+    /**
+     * @brief setSkinClassifier - set up rule that selects skin pixels in enrollImage
+     * @param classifier - self explained
+     */
+    void setSkinClassifier(const SkinClassifier &classifier);
+    /**
+     * @brief setClassifier - set up external cascade classifier that will be used instead of the own one
+     * @param pointer - self explained, 0 means own classifier
+     * @note it allows several instances that are used one at a time to share one loaded cascade
+     */
+    void setClassifier(cv::CascadeClassifier *pointer);
+    /**
+     * @brief setDetectionPeriod - run cascade classifier only once per several frames, track the face in between
+     * @param frames - how many frames share one detection, 1 means detection on each frame (default)
+     * @param minConfidence - tracker match score threshold, detection is performed immediately if score is lower
+     * @note tracker matches downscaled grayscale template of the last detected face around the last face position
+     */
+    void setDetectionPeriod(unsigned int frames, double minConfidence=0.6);
+    /**
+     * @brief setLocalSearch - control face re-detection around the last detected face
+     * @param enabled - search inside the window around the last face first, with face size bounded by the last face size
+     * @param maxMisses - how many consecutive frames could miss the face in the window before whole frame search is performed
+     * @note enabled by default with maxMisses = 1, so whole frame is searched on the same frame when the window search fails,
+     * frames that miss the face in the window before the budget runs out report the last detected face
+     */
+    void setLocalSearch(bool enabled, unsigned int maxMisses=1);
+    /**
+     * @brief setAsyncDetection - run face detection on the background thread
+     * @param enabled - self explained
+     * @note enrollImage posts each frame to the worker and does not wait for the detector,
+     * face rect history is updated only when a new detection result has been published,
+     * detection period and tracker are not used in this mode
+     */
+    void setAsyncDetection(bool enabled);
+    /**
+     * @brief getSampleGeneration - which detection result has been used by the last enrollImage call
+     * @return generation number of the detection result, generations are counted from 1, 0 means no result yet
+     * @note generations keep growing when async detection is switched off and on again
+     */
+    unsigned long getSampleGeneration() const;
+    /**
+     * @brief getDetectionHits - how many frames have got the face from the cascade classifier
+     * @return self explained
+     */
+    unsigned long getDetectionHits() const;
+    /**
+     * @brief getTrackingHits - how many frames have got the face from the tracker
+     * @return self explained
+     */
+    unsigned long getTrackingHits() const;
+    /**
+     * @brief getDetectorCalls - how many times cascade classifier has been called
+     * @return self explained
+     */
+    unsigned long getDetectorCalls() const;
+    /**
+     * @brief dropCounters - set detection and tracking counters to zero
+     */
+    void dropCounters();
 
 private:
     cv::CascadeClassifier m_classifier;
+    cv::CascadeClassifier *pt_classifier;
     cv::Rect *v_rects;
     cv::Rect m_ellRect;
+    cv::Rect m_spansRect;
+    std::vector<cv::Range> v_ellSpans;
     int64 m_markTime;
     unsigned int m_pos;
     uchar m_nofaceframes;
     bool f_firstface;
     cv::Rect m_faceRect;
     cv::Size m_minFaceSize;
+    SkinClassifier m_skinClassifier;
+    cv::Mat m_integral;
+    unsigned int m_detectionPeriod;
+    unsigned int m_framesSinceDetection;
+    double m_minTrackConfidence;
+    std::atomic<unsigned long> m_detectionHits;
+    std::atomic<unsigned long> m_trackingHits;
+    std::atomic<unsigned long> m_detectorCalls;
+    struct LocalSearch
+    {
+        LocalSearch() : enabled(true), maxMisses(1), misses(0) {}
+        bool enabled;
+        unsigned int maxMisses;
+        unsigned int misses;
+        cv::Rect lastDetection;
+    };
+    LocalSearch m_localSearch;
+
+    struct DetectionResult
+    {
+        DetectionResult() : found(false), generation(0) {}
+        cv::Rect rect;
+        bool found;
+        unsigned long generation;
+    };
+    bool f_asyncdetection;
+    bool f_framepending;
+    bool f_searchpending;
+    LocalSearch m_pendingSearch;
+    unsigned long m_sampleGeneration;
+    unsigned long m_detectionGeneration;
+    unsigned long m_firstGeneration;
+    std::thread m_detectionThread;
+    std::mutex m_frameMutex;
+    std::condition_variable m_frameCondition;
+    cv::Mat m_postedFrame;
+    cv::Mat m_pendingFrame;
+    TripleBuffer<DetectionResult> m_publishedDetection;
+    cv::Rect m_trackRect;
+    cv::Mat m_faceTemplate;
+    cv::Mat m_gray;
+    cv::Mat m_search;
+    cv::Mat m_match;
 
     cv::Rect __getMeanRect() const;
     void __updateRects(const cv::Rect &rect);
-    bool __insideEllipse(int x, int y) const;
-    bool __skinColor(unsigned char vR, unsigned char vG, unsigned char vB) const;
+    void __updateEllipseSpans(int rows);
+    void __detectFaces(const cv::Mat &img, std::vector<cv::Rect> &faces, LocalSearch &search);
+    bool __trackFace(const cv::Mat &img, cv::Rect &face);
+    void __updateTemplate(const cv::Mat &img, const cv::Rect &face);
+    void __toGray(const cv::Mat &img);
+    void __postFrame(const cv::Mat &img);
+    void __detectionLoop();
     void __init();
 };
-
-inline bool FaceProcessor::__skinColor(unsigned char vR, unsigned char vG, unsigned char vB) const
-{
-    if( (vR > 95) && (vR > vG) && (vG > 40) && (vB > 20) && ((vR - std::min(vG,vB)) > 5) && ((vR - vG) > 5) )
-        return true;
-    else
-        return false;
-}
 }
 //-------------------------------------------------------
 #endif // FACEPROCESSOR_H
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2015, Taranov Alex <pi-null-mezon@yandex.ru>.
+ * Released to public domain under terms of the BSD Simplified license.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the organization nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *   See <http://www.opensource.org/licenses/bsd-license>
+ */
+#ifndef FRAMEPERIODESTIMATOR_H
+#define FRAMEPERIODESTIMATOR_H
+//-------------------------------------------------------
+#ifdef DLL_BUILD_SETUP
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC __attribute__((visibility("default")))
+    #else
+        #define DLLSPEC __declspec(dllexport)
+    #endif
+#else
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC
+    #else
+        #define DLLSPEC __declspec(dllimport)
+    #endif
+#endif
+//-------------------------------------------------------
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+//-------------------------------------------------------
+namespace vpg {
+
+/**
+ * @brief The FramePeriodEstimator class evaluates actual frame period of the video source on the fly from the capture timestamps
+ * @note median of the first intervals is used as the first estimation, then it is refined by the running average,
+ * intervals that contain lost frames are divided by the number of periods they cover
+ * @note only intervals close to the integer number of periods are treated as lost frames,
+ * several intervals in a row that do not match the period re-anchor the estimation to their median
+ */
+#ifndef VPG_BUILD_FROM_SOURCE
+class DLLSPEC FramePeriodEstimator
+#else
+class FramePeriodEstimator
+#endif
+{
+public:
+    /**
+     * Default constructor
+     * @param initialPeriod_ms - period that is reported until first intervals are collected
+     * @param tolerance - relative change of the estimation that should be reported by update()
+     */
+    FramePeriodEstimator(float initialPeriod_ms = 33.0f, float tolerance = 0.03f);
+    /**
+     * @brief update estimation by the next frame timestamp
+     * @param timestamp_ms - capture moment of the frame in milliseconds
+     * @return true if estimation has changed more than tolerance since the last time true was returned
+     */
+    bool update(double timestamp_ms);
+    /**
+     * @brief update estimation by the frame that has just been read from the video source
+     * @param pointer - video source, CAP_PROP_POS_MSEC is used when it goes forward, zero or repeated values are skipped,
+     * tick count is used if there are several of them in a row
+     * @return true if estimation has changed more than tolerance since the last time true was returned
+     */
+    bool update(cv::VideoCapture *pointer);
+    /**
+     * @brief get current estimation
+     * @return frame period in milliseconds
+     */
+    float getPeriod() const;
+    /**
+     * @brief self explained
+     * @return true when estimation is based on the measured intervals
+     */
+    bool isStable() const;
+    /**
+     * @brief self explained
+     * @return how many intervals have been accepted
+     */
+    unsigned int getIntervals() const;
+    /**
+     * @brief reset - forget all timestamps, initial period will be reported again, CAP_PROP_POS_MSEC will be tried again
+     */
+    void reset();
+
+private:
+    float m_initialPeriod;
+    float m_tolerance;
+    float m_period;
+    float m_reportedPeriod;
+    float v_warmup[3];
+    float v_mismatches[5];
+    double m_lastTimestamp;
+    unsigned int m_intervals;
+    unsigned int m_averaged;
+    unsigned int m_mismatches;
+    unsigned int m_badTimestamps;
+    bool f_first;
+    bool f_ticks;
+
+    bool __report();
+};
+
+}
+//-------------------------------------------------------
+#endif // FRAMEPERIODESTIMATOR_H
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2015, Taranov Alex <pi-null-mezon@yandex.ru>.
+ * Released to public domain under terms of the BSD Simplified license.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the organization nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *   See <http://www.opensource.org/licenses/bsd-license>
+ */
+#ifndef MULTIFACEPROCESSOR_H
+#define MULTIFACEPROCESSOR_H
+//-------------------------------------------------------
+#ifdef DLL_BUILD_SETUP
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC __attribute__((visibility("default")))
+    #else
+        #define DLLSPEC __declspec(dllexport)
+    #endif
+#else
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC
+    #else
+        #define DLLSPEC __declspec(dllimport)
+    #endif
+#endif
+//-------------------------------------------------------
+#include <opencv2/core.hpp>
+#include <opencv2/objdetect.hpp>
+#include "pulseprocessor.h"
+#include "peakdetector.h"
+#include "skinclassifier.h"
+//-------------------------------------------------------
+namespace vpg {
+
+/**
+ * @brief The FaceTrack struct describes one person tracked by MultiFaceProcessor
+ */
+struct FaceTrack
+{
+    int id;
+    cv::Rect rect;
+    float value;
+    unsigned int misses;
+    PulseProcessor *pulseproc;
+    PeakDetector *peakdetector;
+};
+
+/**
+ * @brief The MultiFaceProcessor class should be used for PPG signals mining from the video with several faces
+ * @note faces are detected once per frame, detections are associated with the tracks by the rects overlap,
+ * each track owns PulseProcessor and PeakDetector from the preallocated pool
+ */
+#ifndef VPG_BUILD_FROM_SOURCE
+class DLLSPEC MultiFaceProcessor
+#else
+class MultiFaceProcessor
+#endif
+{
+public:
+    /**
+     * Default class constructor
+     * @param filename - name of file for cv::CascadeClassifier class
+     * @param dT_ms - discretization period in milliseconds, it is passed to the pulse processors
+     * @param maxFaces - how many faces could be tracked simultaneously
+     * @param totalcardiointervals - length of the peak detectors' intervals history
+     */
+    MultiFaceProcessor(const std::string &filename, float dT_ms = 33.0f, unsigned int maxFaces = 8, int totalcardiointervals = 25);
+    /**
+     * Class destructor
+     */
+    ~MultiFaceProcessor();
+    /**
+     * Detect faces, update tracks and enroll all tracked faces by one pass over the image
+     * @param rgbImage - input image, BGR format only
+     * @param resT - where processing time should be written
+     * @note pulse processor of each track is updated inside, use getTracks() to read the results
+     */
+    void enrollImage(const cv::Mat &rgbImage, float &resT);
+    /**
+     * @brief getTracks - self explained
+     * @return tracks in the order of appearance
+     */
+    const std::vector<FaceTrack> &getTracks() const;
+    /**
+     * Load cv::CascadeClassifier face pattern from a file
+     * @param filename - name of file for cv::CascadeClassifier class
+     * @return was file loaded or not
+     */
+    bool loadClassifier(const std::string &filename);
+    /**
+     * @brief check if cascade classifier has been loaded
+     * @return self explained
+     */
+    bool empty();
+    /**
+     * @brief dropTimer - call to drop the internal timer
+     */
+    void dropTimer();
+    /**
+     * @brief setSkinClassifier - set up rule that selects skin pixels
+     * @param classifier - self explained
+     */
+    void setSkinClassifier(const SkinClassifier &classifier);
+
+private:
+    MultiFaceProcessor(const MultiFaceProcessor &);
+    MultiFaceProcessor &operator=(const MultiFaceProcessor &);
+
+    struct TrackHistory
+    {
+        std::vector<cv::Rect> v_rects;
+        unsigned int pos;
+        cv::Rect lastDetection;
+        unsigned int slot;
+    };
+
+    void __associate(const std::vector<cv::Rect> &detections);
+    void __enrollTracks(const cv::Mat &rgbImage);
+    cv::Rect __getMeanRect(const TrackHistory &history) const;
+
+    cv::CascadeClassifier m_classifier;
+    SkinClassifier m_skinClassifier;
+    cv::Size m_minFaceSize;
+    int64 m_markTime;
+    int m_nextId;
+    float m_scaleX;
+    float m_scaleY;
+    std::vector<FaceTrack> v_tracks;
+    std::vector<TrackHistory> v_history;
+    std::vector<PulseProcessor*> v_pulsePool;
+    std::vector<PeakDetector*> v_peakPool;
+    std::vector<unsigned int> v_freeSlots;
+};
+}
+//-------------------------------------------------------
+#endif // MULTIFACEPROCESSOR_H
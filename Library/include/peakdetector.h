@@ -33,6 +33,7 @@
 #endif
 //-------------------------------------------------------
 #include "opencv2/core.hpp"
+#include "ringbuffer.h"
 //-------------------------------------------------------
 namespace vpg {
 #ifndef VPG_BUILD_FROM_SOURCE
@@ -46,6 +47,13 @@ public:
     ~PeakDetector();
 
     void update(float value, float time);
+    /**
+     * @brief updateBatch - the same as n calls of update()
+     * @param values - signal counts
+     * @param times - counts durations in milliseconds
+     * @param n - how many counts should be processed
+     */
+    void updateBatch(const float *values, const float *times, size_t n);
 
     const float *getBinarySignal() const;
     int getSignalLength() const;
@@ -70,38 +78,28 @@ public:
      * @return index value
      */
     float computeBSI();
+    /**
+     * @brief reset - drop signal and intervals history to the state of the newly constructed instance
+     */
+    void reset();
 
 private:
     void __init(int _signallength, int _intervalslength, int _intervalssubsetvolume, float _dT_ms);
     void __updateInterval(float _duration);
-    // For the signal loop array
-    int __loop(int d) const;
-    // For the intervals loop array
-    int __seek(int d) const;
     float __getDuration(int start, int stop);
 
-    int curposforsignal;
-    int curposforinterval;
     int m_intervalssubsetvolume;
     int lastfrontposition;
-    float *v_S;
-    float *v_BS;
-    float *v_T;
-    float *v_DS;
-    float *v_Intervals;
+    RingBuffer<float> v_S;
+    RingBuffer<float> v_BS;
+    RingBuffer<float> v_T;
+    RingBuffer<float> v_DS;
+    RingBuffer<float> v_Intervals;
     int m_signallength;
     int m_intervalslength;
+    float m_dTms;
 };
 
-inline int PeakDetector::__loop(int d) const
-{
-    return ((m_signallength + (d % m_signallength)) % m_signallength);
-}
-
-inline int PeakDetector::__seek(int d) const
-{
-    return ((m_intervalslength + (d % m_intervalslength)) % m_intervalslength);
-}
 }
 //-------------------------------------------------------
 #endif // PEAKDETECTOR_H
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2015, Taranov Alex <pi-null-mezon@yandex.ru>.
+ * Released to public domain under terms of the BSD Simplified license.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the organization nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *   See <http://www.opensource.org/licenses/bsd-license>
+ */
+#ifndef PIXELKERNELS_H
+#define PIXELKERNELS_H
+//-------------------------------------------------------
+#ifdef DLL_BUILD_SETUP
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC __attribute__((visibility("default")))
+    #else
+        #define DLLSPEC __declspec(dllexport)
+    #endif
+#else
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC
+    #else
+        #define DLLSPEC __declspec(dllimport)
+    #endif
+#endif
+//-------------------------------------------------------
+#include <opencv2/core.hpp>
+#include <vector>
+//-------------------------------------------------------
+namespace vpg {
+
+/**
+ * @brief insideEllipse - check if the point lies inside the ellipse
+ * @param ellRect - rect that bounds the ellipse
+ * @param x - column of the point
+ * @param y - row of the point
+ * @return self explained
+ */
+inline bool insideEllipse(const cv::Rect &ellRect, int x, int y)
+{
+    float cx = (ellRect.x + ellRect.width / 2.0f - x) / (ellRect.width / 2.0f);
+    float cy = (ellRect.y + ellRect.height / 2.0f - y) / (ellRect.height / 2.0f);
+    if( (cx*cx + cy*cy) < 1.0f )
+        return true;
+    else
+        return false;
+}
+/**
+ * @brief Thresholds of the RGB skin rule, SkinClassifier::RGB table and accumulateSkinRow() are both made from them
+ */
+enum SkinThresholdRGB {SKIN_RED = 95, SKIN_GREEN = 40, SKIN_BLUE = 20, SKIN_RED_OVER_GREEN = 5};
+/**
+ * @brief skinRGB - RGB skin rule
+ * @return self explained
+ * @note (R > G) and (R - min(G, B) > 5) terms of the original rule are implied by (R - G > 5), so they are omitted
+ */
+inline bool skinRGB(unsigned char vR, unsigned char vG, unsigned char vB)
+{
+    return (vR > SKIN_RED) && (vG > SKIN_GREEN) && (vB > SKIN_BLUE) && ((vR - vG) > SKIN_RED_OVER_GREEN);
+}
+/**
+ * @brief computeEllipseSpans - find columns range [start, end) covered by the ellipse for each row
+ * @param ellRect - rect that bounds the ellipse
+ * @param rows - how many rows (starting from 0) should be described
+ * @param spans - output vector of rows' ranges, empty range if row does not cross the ellipse
+ * @note spans contain exactly the same pixels as insideEllipse() test does, O(rows) complexity
+ */
+DLLSPEC void computeEllipseSpans(const cv::Rect &ellRect, int rows, std::vector<cv::Range> &spans);
+/**
+ * @brief accumulateSkinRow - counts skin pixels of the image row and sums their green values
+ * @param bgr - pointer to the beginning of the row, BGR format only
+ * @param xBegin - first column to process
+ * @param xEnd - column after the last one to process
+ * @param area - number of the skin pixels will be added here
+ * @param green - sum of the green values of the skin pixels will be added here
+ * @note 16 pixels are processed at once when universal intrinsics are available, results are equal to the per-pixel loop
+ */
+DLLSPEC void accumulateSkinRow(const unsigned char *bgr, int xBegin, int xEnd, unsigned int &area, unsigned int &green);
+/**
+ * @brief accumulateColorRow - sums color values of the image row
+ * @param bgr - pointer to the beginning of the row, BGR format only
+ * @param xBegin - first column to process
+ * @param xEnd - column after the last one to process
+ * @param blue - sum of the blue values will be added here
+ * @param green - sum of the green values will be added here
+ * @param red - sum of the red values will be added here
+ */
+DLLSPEC void accumulateColorRow(const unsigned char *bgr, int xBegin, int xEnd, unsigned int &blue, unsigned int &green, unsigned int &red);
+
+}
+//-------------------------------------------------------
+#endif // PIXELKERNELS_H
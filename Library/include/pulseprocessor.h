@@ -32,12 +32,19 @@
     #endif
 #endif
 //-------------------------------------------------------
+#include <memory>
+#include <vector>
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
 #include "peakdetector.h"
+#include "ringbuffer.h"
+#include "spectrumestimator.h"
 //-------------------------------------------------------
 namespace vpg {
 
+class SlidingSpectrum;
+class AsyncSpectrum;
+
 /**
  * @brief The PulseProcessor class should be used for pulse frequency evaluation
  */
@@ -48,21 +55,25 @@ class PulseProcessor
 #endif
 {
 public:
-    enum ProcessType {HeartRate};
+    enum ProcessType {HeartRate, Respiration};
     /**
      * Default constructor
      * @param dT_ms - discretization period in milliseconds
      * @param type - type of desired pulse frequency source/range
+     * @param resample - interpolate counts to the fixed internal rate, signal length is chosen to be fast for cv::dft
+     * @note Respiration type uses 30 s record and 10 s centering interval, so the 0.1 - 0.5 Hz band gets enough bins,
+     * filter is the same as for HeartRate, so heart rate band could be added by addBand()
      */
-    PulseProcessor(float dT_ms = 33.0f, ProcessType type=HeartRate);
+    PulseProcessor(float dT_ms = 33.0f, ProcessType type=HeartRate, bool resample=false);
     /**
      * Overloaded constructor
      * @param Tov_ms - length of signal record in time domain in milliseconds
      * @param Tcn_ms - time interval for signal centering and normalization
      * @param dT_ms - discretization period in milliseconds
      * @param type - type of desired pulse frequency source/range
+     * @param resample - interpolate counts to the fixed internal rate, signal length is chosen to be fast for cv::dft
      */
-    PulseProcessor(float Tov_ms, float Tcn_ms, float Tlpf_ms,  float dT_ms, ProcessType type);
+    PulseProcessor(float Tov_ms, float Tcn_ms, float Tlpf_ms,  float dT_ms, ProcessType type, bool resample=false);
     /**
      * Class destructor
      */
@@ -73,13 +84,31 @@ public:
      * @param time - count measurement time in millisecond
      * @param filter - apply filtering of the input values
      * @note function should be called at each video frame
+     * @note in the resampling mode count could produce zero or several samples of the internal rate
      */
     void update(float value, float time, bool filter=true);
+    /**
+     * Update vpg signal by the block of counts, the result is the same as for the n calls of update()
+     * @param values - count values
+     * @param times - counts measurement times in milliseconds
+     * @param n - how many counts should be processed
+     * @param filter - apply filtering of the input values
+     * @note intended for the recorded traces, normalization runs by passes over the block and attached
+     * PeakDetector is updated by the block too
+     */
+    void updateBatch(const float *values, const float *times, size_t n, bool filter=true);
     /**
      * Compute heart rate
      * @return heart rate in beats per minute
      */
     float computeFrequency();
+    /**
+     * Compute heart rate from the power spectrum of getWindow() that has been evaluated elsewhere
+     * @param power - power spectrum, getLength()/2 + 1 values
+     * @return heart rate in beats per minute
+     * @note is used by SpectrumEngine, in the sliding spectrum mode power is ignored and own bins are used
+     */
+    float computeFrequency(const float *power);
     /**
      * Get signal length
      * @return signal length
@@ -95,6 +124,11 @@ public:
      * @return pointer to data
      */
     const float *getSignal() const;
+    /**
+     * @brief get signal counts in the order of measurement
+     * @return pointer to getLength() contiguous counts from the oldest to the newest one
+     */
+    const float *getWindow() const;
     /**
      * @brief get last frequency estimation
      * @return frequency
@@ -120,43 +154,181 @@ public:
      * @param pointer - self explained
      */
     void setPeakDetector(PeakDetector *pointer);
+    /**
+     * @brief reset - drop signal history to the state of the newly constructed instance, memory is not reallocated
+     * @note attached peak detector is not reset
+     */
+    void reset();
+    /**
+     * @brief setSamplingPeriod - adapt processing to the new discretization period, could be called at any moment
+     * @param dT_ms - discretization period in milliseconds
+     * @note latest counts are kept, signal length could change, so pointer returned by getSignal() should be requested again
+     * @note in the resampling mode internal rate and signal length stay the same
+     * @note period is ignored if the filter interval is shorter than it or the centering interval is shorter than two periods
+     */
+    void setSamplingPeriod(float dT_ms);
+    /**
+     * @brief reconfigure - change record, centering and filter intervals and discretization period of the working instance
+     * @param Tov_ms - length of signal record in time domain in milliseconds
+     * @param Tcn_ms - time interval for signal centering and normalization
+     * @param Tlpf_ms - time interval of the low pass filter
+     * @param dT_ms - discretization period in milliseconds
+     * @note history is interpolated to the new grid, so estimation goes on without the warm-up, pointer returned by getSignal()
+     * should be requested again, attached peak detector is not changed
+     * @note use it when the camera changes frame rate, setSamplingPeriod() is enough for small refinements of the period
+     * @note call is ignored if Tlpf_ms < dT_ms, Tcn_ms < 2*dT_ms or Tov_ms is shorter than any of them
+     */
+    void reconfigure(float Tov_ms, float Tcn_ms, float Tlpf_ms, float dT_ms);
+    /**
+     * @brief self explained
+     * @return discretization period in milliseconds
+     */
+    float getSamplingPeriod() const;
+    /**
+     * @brief setSlidingSpectrum - keep spectrum bins of the frequency band up to date by the sliding DFT on each update()
+     * @param enabled - self explained, full DFT is computed by computeFrequency() otherwise
+     * @note computeFrequency() costs O(band bins) in this mode, so it could be called on every frame
+     */
+    void setSlidingSpectrum(bool enabled);
+    /**
+     * @brief self explained
+     * @return true if sliding spectrum mode is enabled
+     */
+    bool getSlidingSpectrum() const;
+    /**
+     * @brief setSpectrumZoom - refine frequency by the chirp-z transform of the band, evaluated with 1/zoom bin spacing,
+     * and by quadratic interpolation of the peak, so shorter signal record gives the same precision
+     * @param zoom - how many points per DFT bin should be evaluated, 1 disables refinement
+     * @note snr is still evaluated by the DFT bins
+     */
+    void setSpectrumZoom(int zoom);
+    /**
+     * @brief self explained
+     * @return how many points per DFT bin are evaluated by the chirp-z transform
+     */
+    int getSpectrumZoom() const;
+    /**
+     * @brief setProgressiveEstimation - estimate frequency before the signal record is filled
+     * @param enabled - self explained
+     * @param minWindow_ms - estimation starts when the filled part of the record is so long
+     * @note filled part is padded by zeros to the signal length, window grows until it reaches the record length
+     */
+    void setProgressiveEstimation(bool enabled, float minWindow_ms = 2000.0f);
+    /**
+     * @brief getPrefixEstimation - self explained
+     * @return true while progressive estimation is enabled and the signal record is not filled yet
+     */
+    bool getPrefixEstimation() const;
+    /**
+     * @brief getEstimate - latest accepted frequency with its confidence and window length
+     * @return self explained
+     */
+    PulseEstimate getEstimate() const;
+    /**
+     * @brief addBand - estimate one more frequency by the same power spectrum, so extra band costs no transform and no memory for the signal
+     * @param bottom_Hz - bottom frequency limit of the band
+     * @param top_Hz - top frequency limit of the band
+     * @return index of the band, band 0 is the one of the ProcessType, it is refined by setSpectrumZoom() and returned by getFrequency()
+     * @note band should cover several bins, bin width is 1000/Tov_ms Hz
+     */
+    int addBand(float bottom_Hz, float top_Hz);
+    /**
+     * @brief self explained
+     * @return how many bands are estimated, including band 0
+     */
+    int getBands() const;
+    /**
+     * @brief getEstimate - latest accepted frequency of the particular band
+     * @param band - index returned by addBand(), 0 for the band of the ProcessType
+     * @return self explained
+     */
+    PulseEstimate getEstimate(int band) const;
+    /**
+     * @brief setAsyncEstimation - compute spectrum on the background thread
+     * @param enabled - self explained
+     * @note computeFrequency() only posts the copy of the signal record and returns the latest published estimation,
+     * so results lag behind by one call, update() and computeFrequency() never wait for the spectral work
+     * @note sliding spectrum mode is computed in place as it is cheap already
+     */
+    void setAsyncEstimation(bool enabled);
+    /**
+     * @brief self explained
+     * @return true if spectrum is computed on the background thread
+     */
+    bool getAsyncEstimation() const;
 
 private:
 
-    int __loop(int d) const;
-    int __seek(int d) const;
-    void __init(float Tov_ms, float Tcn_ms, float Tlpf_ms, float dT_ms, ProcessType type);
+    SpectrumRecord __record() const;
+    void __configureSpectrum(SpectrumSettings settings);
+    void __pushBlock(const float *values, const float *times, int n);
+    void __anchorSums(const float *raw);
+    void __anchorIntegral(const float *X);
+    void __slideSums(float entering, float leaving);
+    void __centering(float &mean, float &sko);
+    static bool __validGeometry(float Tov_ms, float Tcn_ms, float Tlpf_ms, float dT_ms);
+    void __setGeometry(float Tov_ms, float Tcn_ms, float Tlpf_ms, float dT_ms);
+    void __resampleHistory(const float *values, const float *durations, int length, float *output, int outlength) const;
+    void __init(float Tov_ms, float Tcn_ms, float Tlpf_ms, float dT_ms, ProcessType type, bool resample);
+    void __push(float value, float time, bool filter);
+    void __takeEstimation();
 
-    float *v_raw;
-    float *v_time;
-    float *v_Y;
-    float *v_X;
-    float *v_FA;
+    ProcessType m_type;
+    RingBuffer<float> v_raw;
+    RingBuffer<float> v_time;
+    RingBuffer<float> v_Y;
+    RingBuffer<float> v_X;
     int m_interval;
     int m_length;
     int m_filterlength;
-    int curpos;
-    float m_bottomFrequencyLimit;
-    float m_topFrequencyLimit;
-    float m_snr;
-    float m_Frequency;
     float m_dTms;
+    float m_gridms;
+    float m_Tovms;
+    float m_Tcnms;
+    float m_Tlpfms;
     float m_stdev;
-
-    cv::Mat v_datamat;
-    cv::Mat v_dftmat;
+    // Running sums of the centering window and of the filter history, they are recomputed by __anchor() to drop accumulated error
+    double m_sum;
+    double m_sum2;
+    double m_integral;
+    int m_updates;
+    bool f_dirty;
+    // Temporary arrays of updateBatch()
+    std::vector<float> v_batchT;
+    std::vector<float> v_batchMean;
+    std::vector<float> v_batchSko;
+    std::vector<float> v_batchX;
+    std::vector<float> v_batchY;
+    std::vector<unsigned char> v_batchAnchor;
+    // Resampling state, m_phase is the time passed from the last internal sample to the previous input count
+    bool f_resample;
+    bool f_firstInput;
+    float m_phase;
+    float m_prevValue;
+    // m_filled counts have been pushed since reset
+    int m_filled;
+    // Spectral estimation, zoom and prefix strategies live in m_estimator, sliding and async ones exist only when they are enabled
+    SpectrumEstimator m_estimator;
+    std::unique_ptr<SlidingSpectrum> pt_sliding;
+    std::unique_ptr<AsyncSpectrum> pt_async;
+    unsigned long m_generation; // is incremented by reset(), so async estimations of the dropped history are ignored
 
     PeakDetector *pt_peakdetector = 0;
 };
 
-inline int PulseProcessor::__loop(int d) const
+inline void PulseProcessor::__slideSums(float entering, float leaving)
 {
-    return ((m_length + (d % m_length)) % m_length);
+    m_sum += static_cast<double>(entering) - leaving;
+    m_sum2 += static_cast<double>(entering)*entering - static_cast<double>(leaving)*leaving;
 }
 
-inline int PulseProcessor::__seek(int d) const
+inline void PulseProcessor::__centering(float &mean, float &sko)
 {
-    return ((m_filterlength + (d % m_filterlength)) % m_filterlength);
+    mean = static_cast<float>(m_sum / m_interval);
+    sko = static_cast<float>(std::sqrt( std::max(0.0, (m_sum2 - m_sum*m_sum/m_interval) / (m_interval - 1)) ));
+    m_stdev = sko;
+    if(sko < 0.01f)
+        sko = 1.0f;
 }
 
 }
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2015, Taranov Alex <pi-null-mezon@yandex.ru>.
+ * Released to public domain under terms of the BSD Simplified license.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the organization nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *   See <http://www.opensource.org/licenses/bsd-license>
+ */
+#ifndef PULSEPROCESSORBANK_H
+#define PULSEPROCESSORBANK_H
+//-------------------------------------------------------
+#ifdef DLL_BUILD_SETUP
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC __attribute__((visibility("default")))
+    #else
+        #define DLLSPEC __declspec(dllexport)
+    #endif
+#else
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC
+    #else
+        #define DLLSPEC __declspec(dllimport)
+    #endif
+#endif
+//-------------------------------------------------------
+#include <vector>
+#include <opencv2/core.hpp>
+#include "pulseprocessor.h"
+//-------------------------------------------------------
+namespace vpg {
+
+/**
+ * @brief The PulseProcessorBank class processes many pulse streams of the same discretization period at once,
+ * each stream gets the same signal as PulseProcessor with attached PeakDetector would produce
+ * @note history is stored as structure of arrays: each row holds one count of all streams, so update() walks
+ * contiguous rows and loops over the streams could be vectorized, all streams share ring positions and anchoring schedule
+ */
+#ifndef VPG_BUILD_FROM_SOURCE
+class DLLSPEC PulseProcessorBank
+#else
+class PulseProcessorBank
+#endif
+{
+public:
+    /**
+     * Default constructor
+     * @param streams - how many streams should be processed
+     * @param dT_ms - discretization period in milliseconds
+     * @param type - type of desired pulse frequency source/range
+     * @param intervals - how many cardiointervals should be stored for each stream
+     * @param intervalssubsetvolume - how many of the latest cardiointervals are used to reject outliers
+     */
+    PulseProcessorBank(int streams, float dT_ms = 33.0f, PulseProcessor::ProcessType type = PulseProcessor::HeartRate,
+                       int intervals = 25, int intervalssubsetvolume = 11);
+    /**
+     * Update all streams by one count
+     * @param values - count value of each stream
+     * @param times - count measurement time in milliseconds of each stream
+     * @note normalization, low-pass filtering and extremum search of all streams are advanced at once
+     */
+    void update(const float *values, const float *times);
+    /**
+     * @brief computeFrequency - compute heart rate of the stream
+     * @param stream - stream index
+     * @return heart rate in beats per minute
+     */
+    float computeFrequency(int stream);
+    /**
+     * @brief computeFrequencies - compute heart rate of all streams, streams are distributed among OpenMP threads
+     */
+    void computeFrequencies();
+    /**
+     * @brief self explained
+     * @return number of streams
+     */
+    int streams() const;
+    /**
+     * @brief get signal length
+     * @return signal length
+     */
+    int getLength() const;
+    /**
+     * @brief get last frequency estimation
+     * @param stream - stream index
+     * @return frequency
+     */
+    float getFrequency(int stream) const;
+    /**
+     * @brief get last snr estimation
+     * @param stream - stream index
+     * @return relation between pulse and noise harmonics energies
+     */
+    float getSNR(int stream) const;
+    /**
+     * @brief get last one VPG signal sample value
+     * @param stream - stream index
+     * @return value of the centered and normalized VPG signal
+     */
+    float getSignalSampleValue(int stream) const;
+    /**
+     * @brief get raw signal's stdev
+     * @param stream - stream index
+     * @return standard deviation of the raw signal
+     */
+    float getSignalStdev(int stream) const;
+    /**
+     * @brief getSignal - copy signal counts of the stream
+     * @param stream - stream index
+     * @param signal - output, getLength() counts from the oldest to the newest one
+     */
+    void getSignal(int stream, float *signal) const;
+    /**
+     * @brief get the latest cardiointerval of the stream
+     * @param stream - stream index
+     * @return cardiointerval in milliseconds
+     */
+    float getCurrentInterval(int stream) const;
+    /**
+     * @brief returns average of the last _n cardiointervals of the stream
+     * @param stream - stream index
+     * @param _n - how many intervals should be counted (if n < 0 than all stored intervals should be counted)
+     * @return average value of the cardiointerval
+     */
+    float averageCardiointervalms(int stream, int _n = 9) const;
+    /**
+     * @brief reset - drop history of the stream to the state of the newly constructed instance
+     * @param stream - stream index
+     * @note running sums of all streams are recomputed on the next update()
+     */
+    void reset(int stream);
+
+private:
+    void __anchor();
+    void __peaks(const float *Y);
+    void __updateInterval(int stream, float _duration);
+    float __getDuration(int stream, int start, int stop) const;
+    float __computeFrequency(int stream, float *window, float *power, cv::Mat &dftmat);
+    float *__row(std::vector<float> &v, int row);
+    const float *__row(const std::vector<float> &v, int row) const;
+
+    int m_streams;
+    int m_length;
+    int m_interval;
+    int m_filterlength;
+    int m_intervalslength;
+    int m_intervalssubsetvolume;
+    float m_bottomFrequencyLimit;
+    float m_topFrequencyLimit;
+    float m_dTms;
+    // Rings of rows, m_pos is shared by v_Y, v_time, v_DS and v_BS, v_raw holds centering window only
+    int m_pos;
+    int m_rawpos;
+    int m_xpos;
+    std::vector<float> v_raw;
+    std::vector<float> v_time;
+    std::vector<float> v_Y;
+    std::vector<float> v_X;
+    std::vector<float> v_DS;
+    std::vector<float> v_BS;
+    // Per stream state
+    std::vector<double> v_sum;
+    std::vector<double> v_sum2;
+    std::vector<double> v_integral;
+    std::vector<float> v_stdev;
+    std::vector<double> v_var;
+    std::vector<float> v_frequency;
+    std::vector<float> v_snr;
+    std::vector<unsigned char> v_front;
+    std::vector<int> v_lastfront;
+    std::vector<float> v_intervals;
+    std::vector<int> v_intervalspos;
+    int m_updates;
+    bool f_dirty;
+    // Temporary arrays of computeFrequency()
+    std::vector<float> v_window;
+    std::vector<float> v_FA;
+    cv::Mat v_dftmat;
+};
+
+inline float *PulseProcessorBank::__row(std::vector<float> &v, int row)
+{
+    return v.data() + static_cast<size_t>(row) * m_streams;
+}
+
+inline const float *PulseProcessorBank::__row(const std::vector<float> &v, int row) const
+{
+    return v.data() + static_cast<size_t>(row) * m_streams;
+}
+
+}
+//-------------------------------------------------------
+#endif // PULSEPROCESSORBANK_H
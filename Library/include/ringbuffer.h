@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2015, Taranov Alex <pi-null-mezon@yandex.ru>.
+ * Released to public domain under terms of the BSD Simplified license.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the organization nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *   See <http://www.opensource.org/licenses/bsd-license>
+ */
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+//-------------------------------------------------------
+#ifdef DLL_BUILD_SETUP
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC __attribute__((visibility("default")))
+    #else
+        #define DLLSPEC __declspec(dllexport)
+    #endif
+#else
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC
+    #else
+        #define DLLSPEC __declspec(dllimport)
+    #endif
+#endif
+//-------------------------------------------------------
+#include <algorithm>
+#include <cassert>
+#include <vector>
+//-------------------------------------------------------
+namespace vpg {
+
+/**
+ * @brief The RingBuffer class stores the latest samples of the signal, each sample is written twice into the buffer of the double capacity
+ * @note so the latest samples are always available as contiguous array from the oldest to the newest one, reads need no modulo operations,
+ * capacity is rounded up to the power of two, so positions are wrapped by mask, unless the ring order of data() is needed by the caller
+ */
+template<typename T>
+class RingBuffer
+{
+public:
+    /**
+     * Default constructor
+     * @param length - how many samples should be stored
+     * @param value - initial value of the samples
+     * @param exact - capacity equals to length, so data() and position() give the ring of length() samples
+     */
+    explicit RingBuffer(int length = 1, const T &value = T(), bool exact = false)
+    {
+        assign(length, value, exact);
+    }
+    /**
+     * @brief assign - reallocate buffer and fill it by the value
+     * @param exact - see constructor
+     */
+    void assign(int length, const T &value, bool exact = false)
+    {
+        assert(length > 0);
+        m_length = length;
+        f_exact = exact;
+        m_capacity = length;
+        if(!f_exact) {
+            m_capacity = 1;
+            while(m_capacity < length)
+                m_capacity <<= 1;
+        }
+        f_masked = (m_capacity & (m_capacity - 1)) == 0;
+        m_mask = m_capacity - 1;
+        m_pos = 0;
+        v_data.assign(2 * static_cast<size_t>(m_capacity), value);
+    }
+    /**
+     * @brief fill - set all samples to the value, write position goes to the beginning
+     */
+    void fill(const T &value)
+    {
+        std::fill(v_data.begin(), v_data.end(), value);
+        m_pos = 0;
+    }
+    /**
+     * @brief resize - change length and keep the latest samples, added samples are treated as the oldest ones
+     * @note capacity is chosen the same way as it has been chosen by assign()
+     */
+    void resize(int length, const T &value)
+    {
+        assert(length > 0);
+        const int _n = std::min(length, m_length);
+        const std::vector<T> _latest(window() + m_length - _n, window() + m_length);
+        assign(length, value, f_exact);
+        for(int i = 0; i < _n; i++) {
+            v_data[i] = _latest[i];
+            v_data[i + m_capacity] = _latest[i];
+        }
+        m_pos = __wrap(_n);
+    }
+    /**
+     * @brief push - replace the oldest sample by the new one
+     */
+    void push(const T &value)
+    {
+        v_data[m_pos] = value;
+        v_data[m_pos + m_capacity] = value;
+        m_pos = __wrap(m_pos + 1);
+    }
+    /**
+     * @brief last - access to the recent samples
+     * @param age - 0 for the newest sample, length() - 1 for the oldest one
+     */
+    const T &last(int age = 0) const
+    {
+        return v_data[m_pos + m_capacity - 1 - age];
+    }
+    /**
+     * @brief setLast - overwrite one of the recent samples
+     * @param age - 0 for the newest sample, length() - 1 for the oldest one
+     */
+    void setLast(int age, const T &value)
+    {
+        const int _i = __wrap(m_pos + m_capacity - 1 - age);
+        v_data[_i] = value;
+        v_data[_i + m_capacity] = value;
+    }
+    /**
+     * @brief window - samples from the oldest to the newest one, could be wrapped by cv::Mat header
+     * @return pointer to length() contiguous samples
+     */
+    const T *window() const
+    {
+        return v_data.data() + m_pos + m_capacity - m_length;
+    }
+    /**
+     * @brief data - samples in the ring order, newest sample has index position() - 1
+     * @return pointer to length() samples
+     * @note ring is constructed with exact capacity
+     */
+    const T *data() const
+    {
+        assert(m_capacity == m_length);
+        return v_data.data();
+    }
+    /**
+     * @brief position - where the next sample will be written
+     * @note ring is constructed with exact capacity
+     */
+    int position() const
+    {
+        assert(m_capacity == m_length);
+        return m_pos;
+    }
+    /**
+     * @brief length - self explained
+     */
+    int length() const
+    {
+        return m_length;
+    }
+
+private:
+    int __wrap(int position) const
+    {
+        // Positions are less than the double capacity
+        if(f_masked)
+            return position & m_mask;
+        return position < m_capacity ? position : position - m_capacity;
+    }
+
+    std::vector<T> v_data;
+    int m_length;
+    int m_capacity;
+    int m_mask;
+    int m_pos;
+    bool f_exact;
+    bool f_masked;
+};
+}
+//-------------------------------------------------------
+#endif // RINGBUFFER_H
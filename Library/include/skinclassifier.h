@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2015, Taranov Alex <pi-null-mezon@yandex.ru>.
+ * Released to public domain under terms of the BSD Simplified license.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the organization nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *   See <http://www.opensource.org/licenses/bsd-license>
+ */
+#ifndef SKINCLASSIFIER_H
+#define SKINCLASSIFIER_H
+//-------------------------------------------------------
+#ifdef DLL_BUILD_SETUP
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC __attribute__((visibility("default")))
+    #else
+        #define DLLSPEC __declspec(dllexport)
+    #endif
+#else
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC
+    #else
+        #define DLLSPEC __declspec(dllimport)
+    #endif
+#endif
+//-------------------------------------------------------
+#include <functional>
+#include <memory>
+#include <vector>
+#include <opencv2/core.hpp>
+//-------------------------------------------------------
+namespace vpg {
+
+/**
+ * @brief The SkinClassifier class decides if the color belongs to the skin by means of the lookup table
+ * @note table holds one bit for each of 2^24 RGB colors (2 MB), tables of the predefined rules are shared between all instances
+ */
+#ifndef VPG_BUILD_FROM_SOURCE
+class DLLSPEC SkinClassifier
+#else
+class SkinClassifier
+#endif
+{
+public:
+    enum ColorRule {RGB, YCbCr, HSV, Custom};
+    /**
+     * Default constructor
+     * @param rule - which of the predefined rules should be used
+     */
+    SkinClassifier(ColorRule rule = RGB);
+    /**
+     * Overloaded constructor
+     * @param rule - user defined predicate, takes red, green and blue values
+     * @note predicate is evaluated once for each color while table is created
+     */
+    SkinClassifier(const std::function<bool(unsigned char, unsigned char, unsigned char)> &rule);
+    /**
+     * @brief probe RGB pixel to be a skin projection
+     * @return self explained
+     */
+    bool isSkin(unsigned char vR, unsigned char vG, unsigned char vB) const;
+    /**
+     * @brief counts skin pixels of the image row and sums their green values
+     * @param bgr - pointer to the beginning of the row, BGR format only
+     * @param xBegin - first column to process
+     * @param xEnd - column after the last one to process
+     * @param area - number of the skin pixels will be added here
+     * @param green - sum of the green values of the skin pixels will be added here
+     * @note RGB rule goes through vectorized accumulateSkinRow(), other rules use branch free table lookups
+     */
+    void accumulateRow(const unsigned char *bgr, int xBegin, int xEnd, unsigned int &area, unsigned int &green) const;
+    /**
+     * @brief make binary skin mask
+     * @param inputArray - input image with BGR(CV_8UC3) format
+     * @param outputArray - output CV_8UC1 format
+     * @param minVal - output pixel value if not skin
+     * @param maxVal - output pixel value if skin
+     */
+    void threshold(const cv::Mat &inputArray, cv::Mat &outputArray, unsigned char minVal, unsigned char maxVal) const;
+    /**
+     * @brief get rule that has been used for the table creation
+     * @return self explained
+     */
+    ColorRule getRule() const;
+
+    static bool ruleRGB(unsigned char vR, unsigned char vG, unsigned char vB);
+    static bool ruleYCbCr(unsigned char vR, unsigned char vG, unsigned char vB);
+    static bool ruleHSV(unsigned char vR, unsigned char vG, unsigned char vB);
+
+private:
+    static std::shared_ptr<const std::vector<unsigned char>> __makeTable(const std::function<bool(unsigned char, unsigned char, unsigned char)> &rule);
+    static std::shared_ptr<const std::vector<unsigned char>> __getTable(ColorRule rule);
+    unsigned int __lookup(unsigned char vR, unsigned char vG, unsigned char vB) const;
+
+    ColorRule m_rule;
+    std::shared_ptr<const std::vector<unsigned char>> m_table;
+    const unsigned char *pt_table;
+};
+
+inline unsigned int SkinClassifier::__lookup(unsigned char vR, unsigned char vG, unsigned char vB) const
+{
+    const unsigned int index = (static_cast<unsigned int>(vR) << 16) | (static_cast<unsigned int>(vG) << 8) | vB;
+    return (pt_table[index >> 3] >> (index & 7)) & 1u;
+}
+
+inline bool SkinClassifier::isSkin(unsigned char vR, unsigned char vG, unsigned char vB) const
+{
+    return __lookup(vR, vG, vB) != 0;
+}
+}
+//-------------------------------------------------------
+#endif // SKINCLASSIFIER_H
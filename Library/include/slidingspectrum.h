@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2015, Taranov Alex <pi-null-mezon@yandex.ru>.
+ * Released to public domain under terms of the BSD Simplified license.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the organization nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *   See <http://www.opensource.org/licenses/bsd-license>
+ */
+#ifndef SLIDINGSPECTRUM_H
+#define SLIDINGSPECTRUM_H
+//-------------------------------------------------------
+#ifdef DLL_BUILD_SETUP
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC __attribute__((visibility("default")))
+    #else
+        #define DLLSPEC __declspec(dllexport)
+    #endif
+#else
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC
+    #else
+        #define DLLSPEC __declspec(dllimport)
+    #endif
+#endif
+#include <vector>
+#include "spectrumestimator.h"
+//-------------------------------------------------------
+namespace vpg {
+
+/**
+ * @brief The SlidingSpectrum class keeps DFT bins of the bands up to date by the sliding DFT on each pushed count,
+ * so estimation costs O(band bins) instead of the full transform
+ * @note bins are recomputed exactly once per record length to drop accumulated rounding error
+ */
+#ifndef VPG_BUILD_FROM_SOURCE
+class DLLSPEC SlidingSpectrum
+#else
+class SlidingSpectrum
+#endif
+{
+public:
+    /**
+     * Default constructor
+     */
+    SlidingSpectrum();
+    /**
+     * @brief invalidate - recompute bins on the next push() or estimate(), record length or bands have changed
+     */
+    void invalidate();
+    /**
+     * @brief push - slide bins by the count that has just been appended to the record
+     * @param record - record that already contains the new count
+     * @param settings - settings of the record
+     * @param outgoing - count that has left the record
+     * @param outgoingTime - duration of the count that has left the record
+     */
+    void push(const SpectrumRecord &record, const SpectrumSettings &settings, float outgoing, float outgoingTime);
+    /**
+     * @brief estimate - estimate frequencies of all bands by the tracked bins
+     * @param record - self explained
+     * @param estimator - accepts estimations and gives settings of the record
+     * @return frequency of band 0 in beats per minute
+     */
+    float estimate(const SpectrumRecord &record, SpectrumEstimator &estimator);
+
+private:
+    void __computeBins(const SpectrumRecord &record, int length, int first, int last);
+
+    bool f_dirty;
+    int m_length;
+    int m_first;
+    int m_last;
+    int m_updates;
+    int m_zeros;
+    double m_recordTime;
+    std::vector<double> v_re;
+    std::vector<double> v_im;
+    std::vector<double> v_cos;
+    std::vector<double> v_sin;
+    std::vector<float> v_power;
+};
+
+}
+//-------------------------------------------------------
+#endif // SLIDINGSPECTRUM_H
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2015, Taranov Alex <pi-null-mezon@yandex.ru>.
+ * Released to public domain under terms of the BSD Simplified license.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the organization nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *   See <http://www.opensource.org/licenses/bsd-license>
+ */
+#ifndef SPECTRUMENGINE_H
+#define SPECTRUMENGINE_H
+//-------------------------------------------------------
+#ifdef DLL_BUILD_SETUP
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC __attribute__((visibility("default")))
+    #else
+        #define DLLSPEC __declspec(dllexport)
+    #endif
+#else
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC
+    #else
+        #define DLLSPEC __declspec(dllimport)
+    #endif
+#endif
+//-------------------------------------------------------
+#include <vector>
+#include <opencv2/core.hpp>
+#include "pulseprocessor.h"
+//-------------------------------------------------------
+namespace vpg {
+
+/**
+ * @brief The SpectrumEngine class computes frequencies of many PulseProcessor instances at once
+ * @note windows of the processors with the same signal length are collected into one matrix and transformed
+ * by the single cv::dft(..., DFT_ROWS) call, then band search is made for each row and results are written back
+ * into the processors, so getFrequency() and getSNR() give the same values as computeFrequency() would do
+ */
+#ifndef VPG_BUILD_FROM_SOURCE
+class DLLSPEC SpectrumEngine
+#else
+class SpectrumEngine
+#endif
+{
+public:
+    /**
+     * Default constructor
+     */
+    SpectrumEngine();
+    /**
+     * @brief add - register processor, engine does not take ownership
+     * @param processor - self explained
+     */
+    void add(PulseProcessor *processor);
+    /**
+     * @brief remove - unregister processor
+     * @param processor - self explained
+     * @return false if processor has not been registered
+     */
+    bool remove(PulseProcessor *processor);
+    /**
+     * @brief self explained
+     * @return how many processors are registered
+     */
+    size_t size() const;
+    /**
+     * @brief compute - compute frequencies of all registered processors
+     * @note processors in the sliding spectrum mode use their own bins, processors in the async mode post their records to own workers,
+     * processors in the progressive mode with unfilled record estimate the filled part by themselves
+     */
+    void compute();
+    /**
+     * @brief compute - compute frequencies of the particular processors
+     * @param processors - pointers to processors
+     * @param n - how many processors should be processed
+     */
+    void compute(PulseProcessor *const *processors, size_t n);
+
+private:
+    void __computeRows(PulseProcessor *const *processors, int rows, int length);
+
+    std::vector<PulseProcessor*> v_processors;
+    std::vector<PulseProcessor*> v_order;
+    cv::Mat m_windows;
+    cv::Mat m_spectrums;
+    cv::Mat m_power;
+};
+
+}
+//-------------------------------------------------------
+#endif // SPECTRUMENGINE_H
@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2015, Taranov Alex <pi-null-mezon@yandex.ru>.
+ * Released to public domain under terms of the BSD Simplified license.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the organization nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *   See <http://www.opensource.org/licenses/bsd-license>
+ */
+#ifndef SPECTRUMESTIMATOR_H
+#define SPECTRUMESTIMATOR_H
+//-------------------------------------------------------
+#ifdef DLL_BUILD_SETUP
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC __attribute__((visibility("default")))
+    #else
+        #define DLLSPEC __declspec(dllexport)
+    #endif
+#else
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC
+    #else
+        #define DLLSPEC __declspec(dllimport)
+    #endif
+#endif
+#include <memory>
+#include <vector>
+#include <opencv2/core.hpp>
+//-------------------------------------------------------
+namespace vpg {
+
+/**
+ * @brief powerSpectrum - converts cv::dft output of the real row (CCS packed) into the power spectrum
+ * @param ccs - dft output
+ * @param length - how many counts have been transformed
+ * @param power - output, length/2 + 1 values
+ */
+DLLSPEC void powerSpectrum(const float *ccs, int length, float *power);
+/**
+ * @brief estimatePulseFrequency - finds the strongest harmonic within the band and evaluates its snr
+ * @param power - power spectrum
+ * @param bottom - first bin of the band
+ * @param top - last bin of the band
+ * @param time_ms - duration of the transformed record in milliseconds
+ * @param frequency - output in beats per minute, updated only when snr is high enough
+ * @param snr - output, relation between harmonic and noise energies in dB
+ * @return true if frequency has been updated
+ */
+DLLSPEC bool estimatePulseFrequency(const float *power, int bottom, int top, float time_ms, float &frequency, float &snr);
+
+/**
+ * @brief The PulseEstimate struct describes the latest accepted frequency estimation of PulseProcessor
+ */
+struct PulseEstimate
+{
+    PulseEstimate() : frequency(0.0f), snr(0.0f), confidence(0.0f), window(0.0f) {}
+    float frequency;  // beats per minute
+    float snr;        // of the latest computation, it could be lower than the accepted one
+    float confidence; // from 0 (no estimation) to 1 (full record and snr of 10 dB or higher)
+    float window;     // duration of the record that estimation has been made by, milliseconds
+};
+
+/**
+ * @brief The SpectrumRecord struct points to the signal record that should be estimated, record is not owned
+ */
+struct SpectrumRecord
+{
+    SpectrumRecord(const float *_signal, const float *_time, int _filled) : signal(_signal), time(_time), filled(_filled) {}
+    const float *signal; // SpectrumSettings::length counts from the oldest to the newest one
+    const float *time;   // durations of the counts in milliseconds
+    int filled;          // how many of the newest counts have been measured since reset
+};
+
+/**
+ * @brief The SpectrumBand struct describes extra band that is estimated by the same power spectrum
+ */
+struct SpectrumBand
+{
+    SpectrumBand(float _bottom = 0.0f, float _top = 0.0f) : bottom(_bottom), top(_top) {}
+    float bottom; // Hz
+    float top;    // Hz
+};
+
+/**
+ * @brief The SpectrumSettings struct holds everything spectral estimation of the record depends on,
+ * it is a value type, so async worker gets its own copy with each posted record
+ */
+struct DLLSPEC SpectrumSettings
+{
+    SpectrumSettings();
+    int length;                      // counts in the record
+    int warmup;                      // counts of the centering window warm-up, they are dropped by the prefix estimation
+    float gridms;                    // nominal duration of one count
+    float Tovms;                     // nominal duration of the record, full confidence needs the window of this length
+    float bottomHz;                  // band 0 limits
+    float topHz;
+    std::vector<SpectrumBand> bands; // extra bands
+    int zoom;                        // 1 disables chirp-z refinement of band 0
+    bool progressive;                // estimate the filled part of the record before it is filled completely
+    float minWindowms;               // progressive estimation starts when the filled part is so long
+
+    bool operator==(const SpectrumSettings &other) const;
+    bool operator!=(const SpectrumSettings &other) const;
+    /**
+     * @brief bandsLimits - lowest and highest frequencies of all bands
+     */
+    void bandsLimits(float &bottom_Hz, float &top_Hz) const;
+    /**
+     * @brief nominalBins - bins of the frequency range for the record of the nominal duration,
+     * margins leave room for the record duration variations
+     */
+    void nominalBins(float bottom_Hz, float top_Hz, int &first, int &last) const;
+};
+
+class ZoomSpectrum;
+class PrefixSpectrum;
+
+/**
+ * @brief The SpectrumEstimator class turns the signal record into frequency estimations of all bands,
+ * it keeps the accepted estimations and the spectrum workspace, so PulseProcessor and its async worker use the same code
+ * @note zoom and prefix modes are separate strategy objects that are created by configure() when settings ask for them
+ */
+#ifndef VPG_BUILD_FROM_SOURCE
+class DLLSPEC SpectrumEstimator
+#else
+class SpectrumEstimator
+#endif
+{
+public:
+    SpectrumEstimator();
+    ~SpectrumEstimator();
+    /**
+     * @brief configure - apply settings, workspace is reallocated only when the record length changes
+     * @param settings - self explained
+     * @note accepted estimations are kept, estimations of the new bands are empty
+     */
+    void configure(const SpectrumSettings &settings);
+    /**
+     * @brief self explained
+     */
+    const SpectrumSettings &getSettings() const;
+    /**
+     * @brief reset - drop accepted estimations
+     */
+    void reset();
+    /**
+     * @brief self explained
+     * @return true if the record of filled counts is estimated by the prefix strategy
+     */
+    bool isPrefix(int filled) const;
+    /**
+     * @brief estimate - compute power spectrum of the record by cv::dft and estimate frequencies of all bands
+     * @param record - self explained
+     * @return frequency of band 0 in beats per minute
+     * @note record that is not filled yet is estimated by its filled part in the progressive mode
+     */
+    float estimate(const SpectrumRecord &record);
+    /**
+     * @brief estimate - estimate frequencies by the power spectrum of the full record that has been evaluated elsewhere
+     * @param record - self explained
+     * @param power - getSettings().length/2 + 1 values
+     * @return frequency of band 0 in beats per minute
+     */
+    float estimate(const SpectrumRecord &record, const float *power);
+    /**
+     * @brief estimateByPower - search bands of the power spectrum and accept estimations of high snr
+     * @param power - power spectrum, only bins of the bands are read
+     * @param time - duration of the transformed record in milliseconds, it gives bins spacing
+     * @param signal - transformed counts, they are used by the zoom strategy
+     * @param window - duration of the measured part of the record
+     * @return frequency of band 0 in beats per minute
+     */
+    float estimateByPower(const float *power, float time, const float *signal, float window);
+    /**
+     * @brief sparse - result for the record of zeros, snr of all bands is marked as -10 dB
+     * @return frequency of band 0 in beats per minute
+     */
+    float sparse();
+    /**
+     * @brief self explained
+     * @return true if more than half of the counts are zeros
+     */
+    static bool isSparse(const float *signal, int length);
+    /**
+     * @brief self explained
+     * @param band - 0 for band 0, extra bands are counted from 1
+     */
+    const PulseEstimate &getEstimate(int band = 0) const;
+    /**
+     * @brief estimations of all bands, band 0 goes first
+     */
+    const std::vector<PulseEstimate> &getEstimates() const;
+    /**
+     * @brief setEstimates - accept estimations that have been made by another estimator of the same settings
+     */
+    void setEstimates(const std::vector<PulseEstimate> &estimates);
+
+private:
+    SpectrumEstimator(const SpectrumEstimator &);
+    SpectrumEstimator &operator=(const SpectrumEstimator &);
+    float __recordTime(const SpectrumRecord &record) const;
+
+    SpectrumSettings m_settings;
+    std::vector<PulseEstimate> v_estimates;
+    std::vector<float> v_power;
+    cv::Mat v_dftmat;
+    std::unique_ptr<ZoomSpectrum> pt_zoom;
+    std::unique_ptr<PrefixSpectrum> pt_prefix;
+};
+
+/**
+ * @brief The ZoomSpectrum class refines frequency of band 0 by the chirp-z transform of the band, evaluated with 1/zoom bin spacing,
+ * and by quadratic interpolation of the peak
+ */
+#ifndef VPG_BUILD_FROM_SOURCE
+class DLLSPEC ZoomSpectrum
+#else
+class ZoomSpectrum
+#endif
+{
+public:
+    /**
+     * Default constructor
+     * @param zoom - how many points per DFT bin should be evaluated
+     */
+    explicit ZoomSpectrum(int zoom);
+    /**
+     * @brief invalidate - recompute chirp and kernel on the next refine(), record length or band has changed
+     */
+    void invalidate();
+    /**
+     * @brief refine - find the peak within one bin around the coarse estimation
+     * @param settings - settings of the record
+     * @param frequency - coarse estimation in beats per minute
+     * @param bottom - first bin of band 0
+     * @param top - last bin of band 0
+     * @param time - duration of the transformed record in milliseconds
+     * @param signal - transformed counts
+     * @return refined frequency in beats per minute
+     */
+    float refine(const SpectrumSettings &settings, float frequency, int bottom, int top, float time, const float *signal);
+
+private:
+    void __prepare(int length, int first, int last);
+
+    int m_zoom;
+    bool f_dirty;
+    int m_length;
+    int m_first;
+    int m_last;
+    int m_points;
+    cv::Mat v_chirp;
+    cv::Mat v_kernel;
+    cv::Mat v_buffer;
+    std::vector<float> v_power;
+};
+
+/**
+ * @brief The PrefixSpectrum class estimates the record before it is filled by its filled part padded by zeros,
+ * so the bins have the same spacing as for the full record
+ */
+#ifndef VPG_BUILD_FROM_SOURCE
+class DLLSPEC PrefixSpectrum
+#else
+class PrefixSpectrum
+#endif
+{
+public:
+    /**
+     * Default constructor
+     * @param minWindow_ms - estimation starts when the filled part of the record is so long
+     */
+    explicit PrefixSpectrum(float minWindow_ms);
+    /**
+     * @brief self explained
+     */
+    void setMinWindow(float minWindow_ms);
+    /**
+     * @brief estimate - estimate the filled part of the record
+     * @param record - self explained
+     * @param estimator - accepts estimations and gives settings of the record
+     * @return frequency of band 0 in beats per minute
+     */
+    float estimate(const SpectrumRecord &record, SpectrumEstimator &estimator);
+
+private:
+    float m_minWindowms;
+    std::vector<float> v_padded;
+    std::vector<float> v_power;
+    cv::Mat v_dftmat;
+};
+
+}
+//-------------------------------------------------------
+#endif // SPECTRUMESTIMATOR_H
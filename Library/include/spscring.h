@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2015, Taranov Alex <pi-null-mezon@yandex.ru>.
+ * Released to public domain under terms of the BSD Simplified license.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the organization nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *   See <http://www.opensource.org/licenses/bsd-license>
+ */
+#ifndef SPSCRING_H
+#define SPSCRING_H
+//-------------------------------------------------------
+#ifdef DLL_BUILD_SETUP
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC __attribute__((visibility("default")))
+    #else
+        #define DLLSPEC __declspec(dllexport)
+    #endif
+#else
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC
+    #else
+        #define DLLSPEC __declspec(dllimport)
+    #endif
+#endif
+//-------------------------------------------------------
+#include <atomic>
+#include <vector>
+//-------------------------------------------------------
+namespace vpg {
+
+/**
+ * @brief The SPSCRing class is a bounded lock-free queue for one producer thread and one consumer thread
+ * @note capacity is rounded up to the power of two, items are moved out of the ring on pop
+ */
+template<typename T>
+class SPSCRing
+{
+public:
+    /**
+     * Default constructor
+     * @param capacity - how many items could be stored
+     */
+    explicit SPSCRing(size_t capacity = 8) :
+        m_head(0),
+        m_tail(0)
+    {
+        size_t _size = 1;
+        while(_size < capacity)
+            _size <<= 1;
+        v_items.resize(_size);
+        m_mask = _size - 1;
+    }
+    /**
+     * @brief push - producer side
+     * @param item - self explained
+     * @return false if ring is full
+     */
+    bool push(const T &item)
+    {
+        const size_t _tail = m_tail.load(std::memory_order_relaxed);
+        if(_tail - m_head.load(std::memory_order_acquire) > m_mask)
+            return false;
+        v_items[_tail & m_mask] = item;
+        m_tail.store(_tail + 1, std::memory_order_release);
+        return true;
+    }
+    /**
+     * @brief pop - consumer side
+     * @param item - where item should be moved
+     * @return false if ring is empty
+     */
+    bool pop(T &item)
+    {
+        const size_t _head = m_head.load(std::memory_order_relaxed);
+        if(_head == m_tail.load(std::memory_order_acquire))
+            return false;
+        item = std::move(v_items[_head & m_mask]);
+        m_head.store(_head + 1, std::memory_order_release);
+        return true;
+    }
+    /**
+     * @brief size - approximate number of stored items, exact if called by producer or consumer
+     * @return self explained
+     */
+    size_t size() const
+    {
+        const size_t _head = m_head.load(std::memory_order_acquire);
+        return m_tail.load(std::memory_order_acquire) - _head;
+    }
+    /**
+     * @brief capacity - self explained
+     * @return self explained
+     */
+    size_t capacity() const
+    {
+        return m_mask + 1;
+    }
+
+private:
+    SPSCRing(const SPSCRing &);
+    SPSCRing &operator=(const SPSCRing &);
+
+    std::vector<T> v_items;
+    size_t m_mask;
+    // Counters are written by different threads, so they live in different cache lines
+    alignas(64) std::atomic<size_t> m_head;
+    alignas(64) std::atomic<size_t> m_tail;
+};
+}
+//-------------------------------------------------------
+#endif // SPSCRING_H
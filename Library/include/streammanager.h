@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2015, Taranov Alex <pi-null-mezon@yandex.ru>.
+ * Released to public domain under terms of the BSD Simplified license.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the organization nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *   See <http://www.opensource.org/licenses/bsd-license>
+ */
+#ifndef STREAMMANAGER_H
+#define STREAMMANAGER_H
+//-------------------------------------------------------
+#ifdef DLL_BUILD_SETUP
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC __attribute__((visibility("default")))
+    #else
+        #define DLLSPEC __declspec(dllexport)
+    #endif
+#else
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC
+    #else
+        #define DLLSPEC __declspec(dllimport)
+    #endif
+#endif
+//-------------------------------------------------------
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <opencv2/core.hpp>
+#include <opencv2/objdetect.hpp>
+#include "faceprocessor.h"
+#include "pulseprocessor.h"
+#include "peakdetector.h"
+#include "hrvprocessor.h"
+#include "threadpool.h"
+//-------------------------------------------------------
+namespace vpg {
+
+/**
+ * @brief The StreamResult struct stores the latest results of one stream of StreamManager
+ */
+struct StreamResult
+{
+    StreamResult() : frequency(0.0f), snr(0.0f), cardiointerval(0.0f), lf2hf(0.0f), frames(0), dropped(0), lastFrame(0) {}
+    cv::Rect faceRect;
+    float frequency;
+    float snr;
+    float cardiointerval;
+    float lf2hf;
+    unsigned long frames;
+    unsigned long dropped;
+    unsigned long lastFrame; // number of the latest processed frame, frames are numbered from 1 in the order of pushFrame() calls
+};
+
+/**
+ * @brief The StreamManager class hosts many independent Face->Pulse->Peak->HRV pipelines on one thread pool
+ * @note frames of one stream are processed strictly one after another in the order of arrival, different streams
+ * are processed in parallel, cascade classifier is loaded once per pool worker and shared by the streams
+ */
+#ifndef VPG_BUILD_FROM_SOURCE
+class DLLSPEC StreamManager
+#else
+class StreamManager
+#endif
+{
+public:
+    /**
+     * Default constructor
+     * @param filename - name of file for cv::CascadeClassifier class
+     * @param threads - how many pool workers should be started, 0 means as many as hardware threads
+     */
+    StreamManager(const std::string &filename, unsigned int threads = 0);
+    /**
+     * Class destructor, frames that are still queued are discarded
+     */
+    ~StreamManager();
+    /**
+     * @brief addStream - create new pipeline
+     * @param dT_ms - discretization period of the stream in milliseconds
+     * @param measInterval_ms - how often heart rate and HRV should be recomputed
+     * @param maxQueuedFrames - if stream has so many unprocessed frames, the oldest one will be dropped
+     * @return stream id
+     */
+    int addStream(float dT_ms = 33.0f, float measInterval_ms = 1000.0f, unsigned int maxQueuedFrames = 4);
+    /**
+     * @brief removeStream - destroy pipeline, queued frames are discarded
+     * @param id - stream id
+     * @return false if there is no such stream
+     * @note function blocks until the frame that is being processed is finished, do not call it from the pool worker
+     */
+    bool removeStream(int id);
+    /**
+     * @brief pushFrame - enqueue frame for the processing
+     * @param id - stream id
+     * @param frame - input image, BGR format only, it is copied
+     * @param time_ms - time since the previous frame of this stream, non positive value means discretization period
+     * @return false if there is no such stream
+     */
+    bool pushFrame(int id, const cv::Mat &frame, float time_ms = 0.0f);
+    /**
+     * @brief getResult - read the latest results of the stream
+     * @param id - stream id
+     * @param result - where results should be written
+     * @return false if there is no such stream
+     */
+    bool getResult(int id, StreamResult &result) const;
+    /**
+     * @brief streams - self explained
+     * @return number of the active streams
+     */
+    size_t streams() const;
+    /**
+     * @brief wait - block until all frames that have been pushed are processed
+     */
+    void wait();
+
+private:
+    StreamManager(const StreamManager &);
+    StreamManager &operator=(const StreamManager &);
+
+    struct Frame
+    {
+        cv::Mat image;
+        float time;
+        unsigned long number;
+    };
+    struct Stream
+    {
+        Stream(float dT_ms, float measInterval_ms, unsigned int maxQueuedFrames);
+        FaceProcessor faceproc;
+        PulseProcessor pulseproc;
+        PeakDetector peakdetector;
+        HRVProcessor hrvproc;
+        float dTms;
+        float measIntervalms;
+        float elapsedms;
+        unsigned int maxQueuedFrames;
+        std::deque<Frame> frames;
+        unsigned long pushed;
+        bool scheduled;
+        bool removed;
+        StreamResult result;
+        mutable std::mutex mutex;
+        std::condition_variable idle;
+    };
+
+    void __process(const std::shared_ptr<Stream> &stream);
+    std::shared_ptr<Stream> __find(int id) const;
+
+    std::vector<cv::CascadeClassifier> v_classifiers;
+    ThreadPool m_pool;
+    std::map<int, std::shared_ptr<Stream>> m_streams;
+    mutable std::mutex m_mutex;
+    int m_nextId;
+};
+}
+//-------------------------------------------------------
+#endif // STREAMMANAGER_H
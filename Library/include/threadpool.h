@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2015, Taranov Alex <pi-null-mezon@yandex.ru>.
+ * Released to public domain under terms of the BSD Simplified license.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the organization nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *   See <http://www.opensource.org/licenses/bsd-license>
+ */
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+//-------------------------------------------------------
+#ifdef DLL_BUILD_SETUP
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC __attribute__((visibility("default")))
+    #else
+        #define DLLSPEC __declspec(dllexport)
+    #endif
+#else
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC
+    #else
+        #define DLLSPEC __declspec(dllimport)
+    #endif
+#endif
+//-------------------------------------------------------
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+//-------------------------------------------------------
+namespace vpg {
+
+/**
+ * @brief The ThreadPool class executes tasks on the fixed set of worker threads with work stealing
+ * @note each worker has its own tasks deque, it takes the newest task from its deque and steals the oldest ones
+ * from the other deques when its own is empty, tasks submitted from the worker go to this worker's deque
+ * @note only the deque locks are taken on the hot path, counters are atomic, workers without tasks sleep
+ */
+#ifndef VPG_BUILD_FROM_SOURCE
+class DLLSPEC ThreadPool
+#else
+class ThreadPool
+#endif
+{
+public:
+    /**
+     * Default constructor
+     * @param threads - how many workers should be started, 0 means as many as hardware threads
+     */
+    explicit ThreadPool(unsigned int threads = 0);
+    /**
+     * Class destructor, all submitted tasks are executed before workers are stopped
+     */
+    ~ThreadPool();
+    /**
+     * @brief submit - schedule task for the execution
+     * @param task - self explained, should not throw
+     */
+    void submit(std::function<void()> task);
+    /**
+     * @brief wait - block until all submitted tasks have been executed
+     * @note should not be called from the worker
+     */
+    void wait();
+    /**
+     * @brief size - self explained
+     * @return number of the workers
+     */
+    unsigned int size() const;
+    /**
+     * @brief currentWorker - index of this pool's worker that calls the function
+     * @return worker index or -1 if caller is not a worker of this pool
+     */
+    int currentWorker() const;
+
+private:
+    ThreadPool(const ThreadPool &);
+    ThreadPool &operator=(const ThreadPool &);
+
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void __run(unsigned int index);
+    bool __pop(unsigned int index, std::function<void()> &task);
+
+    std::vector<std::unique_ptr<Worker>> v_workers;
+    std::vector<std::thread> v_threads;
+    // Guards sleeping and waiting only, it is taken by submit() and by the last finished task if somebody sleeps or waits
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::condition_variable m_done;
+    std::atomic<size_t> m_queued;   // tasks that are stored in the deques
+    std::atomic<size_t> m_pending;  // tasks that have not been finished yet
+    std::atomic<unsigned int> m_sleeping;
+    std::atomic<unsigned int> m_next;
+    bool f_stop;
+};
+}
+//-------------------------------------------------------
+#endif // THREADPOOL_H
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2015, Taranov Alex <pi-null-mezon@yandex.ru>.
+ * Released to public domain under terms of the BSD Simplified license.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the organization nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *   See <http://www.opensource.org/licenses/bsd-license>
+ */
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+//-------------------------------------------------------
+#ifdef DLL_BUILD_SETUP
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC __attribute__((visibility("default")))
+    #else
+        #define DLLSPEC __declspec(dllexport)
+    #endif
+#else
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC
+    #else
+        #define DLLSPEC __declspec(dllimport)
+    #endif
+#endif
+//-------------------------------------------------------
+#include <atomic>
+//-------------------------------------------------------
+namespace vpg {
+
+/**
+ * @brief The TripleBuffer class passes the latest value from one writer thread to one reader thread without locks
+ * @note writer and reader own one buffer each and exchange it with the middle one, so neither of them waits for the other
+ */
+template<typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() :
+        m_middle(1),
+        m_front(0),
+        m_back(2) {}
+    /**
+     * @brief back - writer's buffer, fill it and then call publish()
+     * @return self explained
+     */
+    T &back()
+    {
+        return v_buffers[m_back];
+    }
+    /**
+     * @brief publish - make writer's buffer available for the reader
+     */
+    void publish()
+    {
+        m_back = m_middle.exchange(m_back | DIRTY, std::memory_order_acq_rel) & INDEX;
+    }
+    /**
+     * @brief publish - copy value to the writer's buffer and make it available for the reader
+     * @param value - self explained
+     */
+    void publish(const T &value)
+    {
+        back() = value;
+        publish();
+    }
+    /**
+     * @brief update - take the latest published value if there is one that has not been read yet
+     * @return true if front() has been changed
+     */
+    bool update()
+    {
+        if((m_middle.load(std::memory_order_relaxed) & DIRTY) == 0)
+            return false;
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+    /**
+     * @brief front - reader's buffer, it is changed only by update()
+     * @return self explained
+     */
+    const T &front() const
+    {
+        return v_buffers[m_front];
+    }
+
+private:
+    TripleBuffer(const TripleBuffer &);
+    TripleBuffer &operator=(const TripleBuffer &);
+
+    enum {INDEX = 3, DIRTY = 4};
+    T v_buffers[3];
+    std::atomic<unsigned char> m_middle;
+    unsigned char m_front;
+    unsigned char m_back;
+};
+}
+//-------------------------------------------------------
+#endif // TRIPLEBUFFER_H
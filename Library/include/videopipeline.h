@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2015, Taranov Alex <pi-null-mezon@yandex.ru>.
+ * Released to public domain under terms of the BSD Simplified license.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the organization nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *   See <http://www.opensource.org/licenses/bsd-license>
+ */
+#ifndef VIDEOPIPELINE_H
+#define VIDEOPIPELINE_H
+//-------------------------------------------------------
+#ifdef DLL_BUILD_SETUP
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC __attribute__((visibility("default")))
+    #else
+        #define DLLSPEC __declspec(dllexport)
+    #endif
+#else
+    #ifdef TARGET_OS_LINUX
+        #define DLLSPEC
+    #else
+        #define DLLSPEC __declspec(dllimport)
+    #endif
+#endif
+//-------------------------------------------------------
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+#include "faceprocessor.h"
+#include "pulseprocessor.h"
+#include "frameperiodestimator.h"
+#include "peakdetector.h"
+#include "spscring.h"
+//-------------------------------------------------------
+namespace vpg {
+
+/**
+ * @brief The PipelineFrame struct is passed between VideoPipeline stages and finally returned to the caller
+ * @note signal and peak detector data are copied, so the caller could draw them while the next samples are processed
+ */
+struct PipelineFrame
+{
+    PipelineFrame() : number(0), captureTick(0), time(0.0f), value(0.0f), measured(false), frequency(0.0f), snr(0.0f), sample(0.0f), cardiointerval(0.0f), latency(0.0f) {}
+    cv::Mat image;
+    unsigned long number;
+    int64 captureTick;
+    float time;
+    float value;
+    cv::Rect faceRect;
+    bool measured;
+    float frequency;
+    float snr;
+    float sample;
+    float cardiointerval;
+    float latency;
+    std::vector<float> signal;
+    std::vector<float> binarySignal;
+    std::vector<float> intervals;
+};
+
+/**
+ * @brief The StageStats struct describes one VideoPipeline stage
+ */
+struct StageStats
+{
+    unsigned long processed;
+    unsigned long dropped;
+    float averageLatency;
+    float maxLatency;
+    size_t queueDepth;
+};
+
+/**
+ * @brief The VideoPipeline class runs capture, face enrollment and pulse processing on the separate threads
+ * @note stages are connected by the bounded lock-free rings, capture of the video device never waits for
+ * the next stages, consumers of its rings take the newest frame and drop the older ones, so latency does not grow
+ * when they are busy, capture of the video file waits instead and all frames are processed
+ * @note face detection runs within the enrollment stage, enable FaceProcessor::setAsyncDetection() to move it to own thread
+ */
+#ifndef VPG_BUILD_FROM_SOURCE
+class DLLSPEC VideoPipeline
+#else
+class VideoPipeline
+#endif
+{
+public:
+    enum Stage {Capture, Enroll, Pulse};
+    /**
+     * Default constructor
+     * @param capture - opened video source
+     * @param faceproc - self explained
+     * @param pulseproc - self explained, attached peak detector is updated by the pulse stage too
+     * @param measInterval_ms - how often heart rate should be recomputed
+     * @param framePeriod_ms - frame period that is used for the video file, 0 means video device with the measured time,
+     * in the last case sampling period of the pulseproc is adjusted to the estimated frame period
+     * @param ringSize - capacity of each ring between stages
+     * @param peakdetector - if it is not 0, its data will be copied into the output frames
+     * @note objects are used by the pipeline threads after start(), do not use them until stop()
+     */
+    VideoPipeline(cv::VideoCapture *capture, FaceProcessor *faceproc, PulseProcessor *pulseproc, float measInterval_ms = 1000.0f,
+                  float framePeriod_ms = 0.0f, size_t ringSize = 8, PeakDetector *peakdetector = 0);
+    /**
+     * Class destructor, stops the pipeline
+     */
+    ~VideoPipeline();
+    /**
+     * @brief start - launch stage threads
+     */
+    void start();
+    /**
+     * @brief stop - stop stage threads, frames that have not been returned yet are discarded
+     */
+    void stop();
+    /**
+     * @brief pop - take the next processed frame, it does not wait
+     * @param frame - where frame should be moved
+     * @return false if there is no processed frame yet
+     * @note for the video device the newest frame is returned and the older ones are counted as dropped by the pulse stage,
+     * measured flag of the dropped frames goes to the returned one
+     */
+    bool pop(PipelineFrame &frame);
+    /**
+     * @brief finished - video source is over and all frames have been returned
+     * @return self explained
+     */
+    bool finished() const;
+    /**
+     * @brief getStats - self explained
+     * @param stage - self explained
+     * @return processed and dropped frames counts, processing time per frame in ms, size of the stage's output ring
+     */
+    StageStats getStats(Stage stage) const;
+
+private:
+    VideoPipeline(const VideoPipeline &);
+    VideoPipeline &operator=(const VideoPipeline &);
+
+    struct Counters
+    {
+        Counters() : processed(0), dropped(0), totalTicks(0), maxTicks(0) {}
+        std::atomic<unsigned long> processed;
+        std::atomic<unsigned long> dropped;
+        std::atomic<int64> totalTicks;
+        std::atomic<int64> maxTicks;
+    };
+
+    void __capture();
+    void __enroll();
+    void __pulse();
+    bool __popLatest(SPSCRing<PipelineFrame> &ring, PipelineFrame &frame, Stage stage);
+    void __account(Stage stage, int64 startTick);
+    void __wait() const;
+
+    cv::VideoCapture *pt_capture;
+    FaceProcessor *pt_faceproc;
+    PulseProcessor *pt_pulseproc;
+    PeakDetector *pt_peakdetector;
+    float m_measIntervalms;
+    float m_framePeriodms;
+    SPSCRing<PipelineFrame> m_captured;
+    SPSCRing<PipelineFrame> m_enrolled;
+    SPSCRing<PipelineFrame> m_processed;
+    Counters v_counters[3];
+    FramePeriodEstimator m_periodEstimator;
+    std::vector<std::thread> v_threads;
+    std::atomic<bool> f_run;
+    std::atomic<bool> v_done[3];
+};
+}
+//-------------------------------------------------------
+#endif // VIDEOPIPELINE_H
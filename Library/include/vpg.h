@@ -19,9 +19,24 @@
 #define VPG_H
 
 #include "pulseprocessor.h"
+#include "pulseprocessorbank.h"
+#include "spectrumengine.h"
+#include "spectrumestimator.h"
+#include "slidingspectrum.h"
+#include "asyncspectrum.h"
+#include "frameperiodestimator.h"
 #include "peakdetector.h"
 #include "hrvprocessor.h"
 #include "faceprocessor.h"
+#include "multifaceprocessor.h"
+#include "pixelkernels.h"
+#include "skinclassifier.h"
+#include "triplebuffer.h"
+#include "ringbuffer.h"
+#include "threadpool.h"
+#include "streammanager.h"
+#include "spscring.h"
+#include "videopipeline.h"
 
 #endif
 
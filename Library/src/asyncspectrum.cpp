@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2015, Taranov Alex <pi-null-mezon@yandex.ru>.
+ * Released to public domain under terms of the BSD Simplified license.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the organization nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *   See <http://www.opensource.org/licenses/bsd-license>
+ */
+#include "asyncspectrum.h"
+
+namespace vpg {
+
+AsyncSpectrum::AsyncSpectrum() :
+    f_stop(false),
+    f_snapshotpending(false)
+{
+    m_estimationThread = std::thread(&AsyncSpectrum::__estimationLoop, this);
+}
+
+AsyncSpectrum::~AsyncSpectrum()
+{
+    {
+        std::lock_guard<std::mutex> _lock(m_snapshotMutex);
+        f_stop = true;
+    }
+    m_snapshotCondition.notify_one();
+    m_estimationThread.join();
+}
+
+void AsyncSpectrum::post(const SpectrumRecord &record, const SpectrumSettings &settings, unsigned long generation)
+{
+    // Copy is made outside of the lock, then snapshots are swapped, so the worker always gets the newest record
+    Snapshot &_snapshot = m_postedSnapshot;
+    _snapshot.signal.assign(record.signal, record.signal + settings.length);
+    _snapshot.time.assign(record.time, record.time + settings.length);
+    _snapshot.filled = record.filled;
+    _snapshot.settings = settings;
+    _snapshot.generation = generation;
+    {
+        std::lock_guard<std::mutex> _lock(m_snapshotMutex);
+        std::swap(m_postedSnapshot, m_pendingSnapshot);
+        f_snapshotpending = true;
+    }
+    m_snapshotCondition.notify_one();
+}
+
+bool AsyncSpectrum::take(unsigned long generation, SpectrumEstimator &estimator)
+{
+    if(m_publishedEstimation.update() == false)
+        return false;
+    const Estimation &_estimation = m_publishedEstimation.front();
+    if(_estimation.generation != generation)
+        return false;
+    estimator.setEstimates(_estimation.estimates);
+    return true;
+}
+
+void AsyncSpectrum::__estimationLoop()
+{
+    SpectrumEstimator _estimator;
+    Snapshot _snapshot;
+    // Generation is taken from the first snapshot, so the worker does not read the caller's state
+    bool _started = false;
+    unsigned long _generation = 0;
+    while(true) {
+        {
+            std::unique_lock<std::mutex> _lock(m_snapshotMutex);
+            m_snapshotCondition.wait(_lock, [this] { return f_snapshotpending || f_stop; });
+            if(f_stop)
+                return;
+            std::swap(_snapshot, m_pendingSnapshot);
+            f_snapshotpending = false;
+        }
+        if(!_started || (_snapshot.generation != _generation)) {
+            _estimator.reset();
+            _generation = _snapshot.generation;
+            _started = true;
+        }
+        if(_estimator.getSettings() != _snapshot.settings)
+            _estimator.configure(_snapshot.settings);
+        _estimator.estimate(SpectrumRecord(_snapshot.signal.data(), _snapshot.time.data(), _snapshot.filled));
+
+        Estimation &_estimation = m_publishedEstimation.back();
+        _estimation.estimates = _estimator.getEstimates();
+        _estimation.generation = _snapshot.generation;
+        m_publishedEstimation.publish();
+    }
+}
+
+} // end of namespace vpg
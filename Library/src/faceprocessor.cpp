@@ -16,11 +16,40 @@
  *   See <http://www.opensource.org/licenses/bsd-license>
  */
 #include "faceprocessor.h"
+#include "pixelkernels.h"
 
 #define FACE_PROCESSOR_LENGTH 33
+#define FACE_TEMPLATE_WIDTH 32
 
 namespace vpg {
 
+void downscaleForDetection(const cv::Mat &rgbImage, cv::Mat &img, float &scaleX, float &scaleY)
+{
+    scaleX = 1.0f;
+    scaleY = 1.0f;
+    if(rgbImage.cols > 640 || rgbImage.rows > 480) {
+        if( ((float)rgbImage.cols/rgbImage.rows) > 14.0/9.0 ) {
+            cv::resize(rgbImage, img, cv::Size(640, 360), 0.0, 0.0, cv::INTER_AREA);
+            scaleX = (float)rgbImage.cols / 640.0f;
+            scaleY = (float)rgbImage.rows / 360.0f;
+        } else if ( ((float)rgbImage.cols/rgbImage.rows) > 1.0) {
+            cv::resize(rgbImage, img, cv::Size(640, 480), 0.0, 0.0, cv::INTER_AREA);
+            scaleX = (float)rgbImage.cols / 640.0f;
+            scaleY = (float)rgbImage.rows / 480.0f;
+        } else if ( ((float)rgbImage.rows/rgbImage.cols) > 14.0/9.0) {
+            cv::resize(rgbImage, img, cv::Size(360, 640), 0.0, 0.0, cv::INTER_AREA);
+            scaleX = (float)rgbImage.cols / 360.0f;
+            scaleY = (float)rgbImage.rows / 640.0f;
+        } else {
+            cv::resize(rgbImage, img, cv::Size(480, 640), 0.0, 0.0, cv::INTER_AREA);
+            scaleX = (float)rgbImage.cols / 480.0f;
+            scaleY = (float)rgbImage.rows / 640.0f;
+        }
+    } else {
+        img = rgbImage;
+    }
+}
+
 FaceProcessor::FaceProcessor(const std::string &filename)
 {
     __init();
@@ -38,11 +67,23 @@ void FaceProcessor::__init()
     m_pos = 0;
     m_nofaceframes = 0;
     f_firstface = true;
+    pt_classifier = &m_classifier;
     m_minFaceSize = cv::Size(110,110);
+    m_detectionPeriod = 1;
+    m_framesSinceDetection = 0;
+    m_minTrackConfidence = 0.6;
+    f_asyncdetection = false;
+    f_framepending = false;
+    f_searchpending = false;
+    m_sampleGeneration = 0;
+    m_detectionGeneration = 0;
+    m_firstGeneration = 1;
+    dropCounters();
 }
 
 FaceProcessor::~FaceProcessor()
 {
+    setAsyncDetection(false);
     delete[] v_rects;
 }
 
@@ -50,40 +91,51 @@ void FaceProcessor::enrollImage(const cv::Mat &rgbImage, float &resV, float &res
 {
     cv::Mat img;
     float scaleX = 1.0f, scaleY = 1.0f;
-    if(rgbImage.cols > 640 || rgbImage.rows > 480) {
-        if( ((float)rgbImage.cols/rgbImage.rows) > 14.0/9.0 ) {
-            cv::resize(rgbImage, img, cv::Size(640, 360), 0.0, 0.0, cv::INTER_AREA);
-            scaleX = (float)rgbImage.cols / 640.0f;
-            scaleY = (float)rgbImage.rows / 360.0f;
-        } else if ( ((float)rgbImage.cols/rgbImage.rows) > 1.0) {
-            cv::resize(rgbImage, img, cv::Size(640, 480), 0.0, 0.0, cv::INTER_AREA);
-            scaleX = (float)rgbImage.cols / 640.0f;
-            scaleY = (float)rgbImage.rows / 480.0f;
-        } else if ( ((float)rgbImage.rows/rgbImage.cols) > 14.0/9.0) {
-            cv::resize(rgbImage, img, cv::Size(360, 640), 0.0, 0.0, cv::INTER_AREA);
-            scaleX = (float)rgbImage.cols / 360.0f;
-            scaleY = (float)rgbImage.rows / 640.0f;
+    downscaleForDetection(rgbImage, img, scaleX, scaleY);
+
+    std::vector<cv::Rect> faces;
+    bool _newdetection = true;
+    if(f_asyncdetection) {
+        // Detection runs on the worker, enrollment uses the latest published result
+        __postFrame(img);
+        // Results published by the worker of the previous async session are stale
+        _newdetection = m_publishedDetection.update() && (m_publishedDetection.front().generation >= m_firstGeneration);
+        if(_newdetection) {
+            const DetectionResult &_result = m_publishedDetection.front();
+            if(_result.found)
+                faces.push_back(_result.rect);
+            m_sampleGeneration = _result.generation;
+        }
+    } else if(m_detectionPeriod > 1) {
+        __toGray(img);
+        cv::Rect _tracked;
+        if((m_framesSinceDetection + 1 < m_detectionPeriod) && __trackFace(m_gray, _tracked)) {
+            faces.push_back(_tracked);
+            m_framesSinceDetection++;
+            m_trackingHits++;
         } else {
-            cv::resize(rgbImage, img, cv::Size(480, 640), 0.0, 0.0, cv::INTER_AREA);
-            scaleX = (float)rgbImage.cols / 480.0f;
-            scaleY = (float)rgbImage.rows / 640.0f;
+            __detectFaces(img, faces, m_localSearch);
+            m_framesSinceDetection = 0;
+            if(faces.size() > 0)
+                __updateTemplate(m_gray, faces[0]);
+            else
+                m_faceTemplate.release();
         }
     } else {
-        img = rgbImage;
+        __detectFaces(img, faces, m_localSearch);
     }
 
-    std::vector<cv::Rect> faces;
-    m_classifier.detectMultiScale(img, faces, 1.3, 5, cv::CASCADE_FIND_BIGGEST_OBJECT, m_minFaceSize, m_minFaceSize*4);
-
-    if(faces.size() > 0) {
-        __updateRects(faces[0]);
-        m_nofaceframes = 0;
-        f_firstface = false;
-    } else {
-        m_nofaceframes++;
-        if(m_nofaceframes == FACE_PROCESSOR_LENGTH) {
-            f_firstface = true;
-            __updateRects(cv::Rect(0,0,0,0));
+    if(_newdetection) {
+        if(faces.size() > 0) {
+            __updateRects(faces[0]);
+            m_nofaceframes = 0;
+            f_firstface = false;
+        } else {
+            m_nofaceframes++;
+            if(m_nofaceframes == FACE_PROCESSOR_LENGTH) {
+                f_firstface = true;
+                __updateRects(cv::Rect(0,0,0,0));
+            }
         }
     }
 
@@ -102,42 +154,31 @@ void FaceProcessor::enrollImage(const cv::Mat &rgbImage, float &resV, float &res
         int dY = H / 30;
         // It will be rect inside m_faceRect
         m_ellRect = cv::Rect(dX, -6 * dY, W - 2 * dX, H + 6 * dY);
-        int X = m_ellRect.x;
-        W = m_ellRect.width;
-        unsigned char *ptr;
+        __updateEllipseSpans(H);
 		if (region.channels() == 1)
 		{
-			unsigned char tG = 0;
-#pragma omp parallel for private(ptr,tG) reduction(+:area,green)
+			unsigned char *ptr;
+#pragma omp parallel for private(ptr) reduction(+:area,green)
 			for (int j = 0; j < H; j++)
 			{
 				ptr = region.ptr(j);
-				for (int i = X; i < X + W; i++) {
-					tG = ptr[3 * i + 1];
-					if (__insideEllipse(i, j)) {
-						area++;
-						green += tG;
-					}
+				for (int i = v_ellSpans[j].start; i < v_ellSpans[j].end; i++) {
+					area++;
+					green += ptr[3 * i + 1];
 				}
 			}
 		}
 		else
 		{
-			unsigned char tR = 0, tG = 0, tB = 0;
-#pragma omp parallel for private(ptr,tB,tG,tR) reduction(+:area,green)
+			unsigned int rowArea = 0, rowGreen = 0;
+#pragma omp parallel for private(rowArea,rowGreen) reduction(+:area,green)
 			for (int j = 0; j < H; j++)
 			{
-				ptr = region.ptr(j);
-				for (int i = X; i < X + W; i++)
-				{
-					tB = ptr[3*i];
-					tG = ptr[3 * i + 1];
-					tR = ptr[3*i+2];
-					if (__skinColor(tR, tG, tB) && __insideEllipse(i, j)) {
-						area++;
-						green += tG;
-					}
-				}
+				rowArea = 0;
+				rowGreen = 0;
+				m_skinClassifier.accumulateRow(region.ptr(j), v_ellSpans[j].start, v_ellSpans[j].end, rowArea, rowGreen);
+				area += rowArea;
+				green += rowGreen;
 			}
 		}
     }
@@ -165,19 +206,17 @@ void FaceProcessor::enrollImagePart(const cv::Mat &rgbImage, float &resRed, floa
         cv::Mat region = cv::Mat(rgbImage,roirect);
         unsigned char *ptr;
         unsigned char tR = 0, tG = 0, tB = 0;
-        #pragma omp parallel for private(ptr,tB,tG,tR) reduction(+:area,green)
+        #pragma omp parallel for private(ptr,tB,tG,tR) reduction(+:area,red,green,blue)
         for(int j = 0; j < roirect.height; j++) {
             ptr = region.ptr(j);
             for(int i = 0; i < roirect.width; i++) {
                 tB = ptr[3*i];
                 tG = ptr[3*i+1];
                 tR = ptr[3*i+2];
-                if( /*__skinColor(tR, tG, tB)*/ true) {
-                    area++;
-                    red   += tR;
-                    green += tG;
-                    blue  += tB;
-                }
+                area++;
+                red   += tR;
+                green += tG;
+                blue  += tB;
             }
         }
     }
@@ -215,45 +254,55 @@ void FaceProcessor::enrollFace(const cv::Mat &rgbImage, float *v_resRed, float *
         m_ellRect = cv::Rect(X, Y - 6 * dY, W, H + 6 * dY);
         X = m_ellRect.x;
         W = m_ellRect.width;
-        unsigned char *p;
-        unsigned char tG = 0, tR = 0, tB = 0;
-        for(int j = 0; j < Y + H; j++) {
-            p = region.ptr(j); //takes pointer to beginning of data on row
-            for(int i = X; i < X + W; i++) {
-                tB = p[3*i];
-                tG = p[3*i+1];
-                tR = p[3*i+2];
-                if(/*__skinColor(tR, tG, tB) &&*/ __insideEllipse(i, j)) {
-                    if( j < Y + 2* H / 7 ) {
-                        if(i < X + W / 2) {
-                            b[3] += tB;
-                            g[3] += tG;
-                            r[3] += tR;
-                            a[3]++;
-                            //p[3*i] %= 32;
-                            //p[3*i+2] %= 32;
-                        } else if (i > X + W / 2) {
-                            b[0] += tB;
-                            g[0] += tG;
-                            r[0] += tR;;
-                            a[0]++;
-                            //p[3*i] %= 32;
-                        }
-                    } else if( (j > Y + 3*H / 7) && (j < Y + 5*H / 7)) {
-                        if( i < X + W / 2) {
-                            b[2] += tB;
-                            g[2] += tG;
-                            r[2] += tR;
-                            a[2]++;
-                            //p[3*i+1] %= 32;
-                        } else if (i > X + W / 2) {
-                            b[1] += tB;
-                            g[1] += tG;
-                            r[1] += tR;
-                            a[1]++;
-                            //p[3*i+2] %= 32;
-                        }
-                    }
+        __updateEllipseSpans(Y + H);
+        // Band and quadrant are the same for all pixels of the row segment, so they are chosen once per row
+        const int _top = Y + 2 * H / 7, _middle = Y + 3 * H / 7, _bottom = Y + 5 * H / 7, _center = X + W / 2;
+        #pragma omp parallel
+        {
+            unsigned long _b[] = {0, 0, 0, 0};
+            unsigned long _g[] = {0, 0, 0, 0};
+            unsigned long _r[] = {0, 0, 0, 0};
+            unsigned long _a[] = {0, 0, 0, 0};
+            #pragma omp for
+            for(int j = 0; j < Y + H; j++) {
+                int _left, _right;
+                if(j < _top) {
+                    _left = 3;
+                    _right = 0;
+                } else if((j > _middle) && (j < _bottom)) {
+                    _left = 2;
+                    _right = 1;
+                } else {
+                    continue;
+                }
+                const unsigned char *p = region.ptr(j);
+                const cv::Range &_span = v_ellSpans[j];
+                // Central column belongs to none of the quadrants
+                const int _leftEnd = std::min(_span.end, _center), _rightBegin = std::max(_span.start, _center + 1);
+                unsigned int _rb = 0, _rg = 0, _rr = 0;
+                if(_leftEnd > _span.start) {
+                    accumulateColorRow(p, _span.start, _leftEnd, _rb, _rg, _rr);
+                    _b[_left] += _rb;
+                    _g[_left] += _rg;
+                    _r[_left] += _rr;
+                    _a[_left] += _leftEnd - _span.start;
+                }
+                if(_span.end > _rightBegin) {
+                    _rb = _rg = _rr = 0;
+                    accumulateColorRow(p, _rightBegin, _span.end, _rb, _rg, _rr);
+                    _b[_right] += _rb;
+                    _g[_right] += _rg;
+                    _r[_right] += _rr;
+                    _a[_right] += _span.end - _rightBegin;
+                }
+            }
+            #pragma omp critical
+            {
+                for(int k = 0; k < 4; k++) {
+                    b[k] += _b[k];
+                    g[k] += _g[k];
+                    r[k] += _r[k];
+                    a[k] += _a[k];
                 }
             }
         }
@@ -275,6 +324,208 @@ void FaceProcessor::enrollFace(const cv::Mat &rgbImage, float *v_resRed, float *
 }
 
 
+namespace {
+// Region rows described by the lists of [start, end) column ranges
+struct RegionRows
+{
+    int top = 0;
+    int bottom = 0;
+    std::vector<int> offsets; // spans of row y are [offsets[y-top], offsets[y-top+1])
+    std::vector<cv::Range> spans;
+};
+
+void rasterizeRegion(const vpg::EnrollRegion &region, const cv::Rect &imageRect, RegionRows &rows)
+{
+    rows.spans.clear();
+    rows.offsets.assign(1, 0);
+    cv::Rect bounds;
+    switch(region.shape) {
+        case vpg::EnrollRegion::Rectangle:
+            bounds = (region.rect == cv::Rect() ? imageRect : region.rect) & region.clip & imageRect;
+            for(int y = bounds.y; y < bounds.y + bounds.height; y++) {
+                rows.spans.push_back(cv::Range(bounds.x, bounds.x + bounds.width));
+                rows.offsets.push_back(static_cast<int>(rows.spans.size()));
+            }
+            break;
+        case vpg::EnrollRegion::Ellipse: {
+            bounds = region.rect & region.clip & imageRect;
+            std::vector<cv::Range> _ellspans;
+            if(bounds.area() > 0)
+                vpg::computeEllipseSpans(region.rect, bounds.y + bounds.height, _ellspans);
+            for(int y = bounds.y; y < bounds.y + bounds.height; y++) {
+                const int xb = std::max(_ellspans[y].start, bounds.x);
+                const int xe = std::min(_ellspans[y].end, bounds.x + bounds.width);
+                if(xe > xb)
+                    rows.spans.push_back(cv::Range(xb, xe));
+                rows.offsets.push_back(static_cast<int>(rows.spans.size()));
+            }
+        } break;
+        case vpg::EnrollRegion::Polygon: {
+            if(region.polygon.size() < 3)
+                break;
+            cv::Rect _polyrect = cv::boundingRect(region.polygon);
+            bounds = _polyrect & region.clip & imageRect;
+            if(bounds.area() == 0)
+                break;
+            cv::Mat _mask = cv::Mat::zeros(_polyrect.height, _polyrect.width, CV_8UC1);
+            std::vector<std::vector<cv::Point>> _polygons(1, region.polygon);
+            cv::fillPoly(_mask, _polygons, cv::Scalar(255), cv::LINE_8, 0, cv::Point(-_polyrect.x, -_polyrect.y));
+            for(int y = bounds.y; y < bounds.y + bounds.height; y++) {
+                const unsigned char *_ptr = _mask.ptr(y - _polyrect.y) - _polyrect.x;
+                int x = bounds.x;
+                while(x < bounds.x + bounds.width) {
+                    while(x < bounds.x + bounds.width && _ptr[x] == 0)
+                        x++;
+                    const int xb = x;
+                    while(x < bounds.x + bounds.width && _ptr[x] != 0)
+                        x++;
+                    if(x > xb)
+                        rows.spans.push_back(cv::Range(xb, x));
+                }
+                rows.offsets.push_back(static_cast<int>(rows.spans.size()));
+            }
+        } break;
+    }
+    rows.top = bounds.y;
+    rows.bottom = bounds.y + static_cast<int>(rows.offsets.size()) - 1;
+}
+}
+
+void FaceProcessor::enrollRegions(const cv::Mat &rgbImage, const std::vector<EnrollRegion> &regions, std::vector<RegionStats> &v_stats, float &resT)
+{
+    const int _regions = static_cast<int>(regions.size());
+    const cv::Rect _imageRect(0, 0, rgbImage.cols, rgbImage.rows);
+    std::vector<RegionRows> _rows(_regions);
+    int _top = rgbImage.rows, _bottom = 0;
+    for(int k = 0; k < _regions; k++) {
+        rasterizeRegion(regions[k], _imageRect, _rows[k]);
+        if(_rows[k].bottom > _rows[k].top) {
+            _top = std::min(_top, _rows[k].top);
+            _bottom = std::max(_bottom, _rows[k].bottom);
+        }
+    }
+
+    std::vector<unsigned long> r(_regions, 0), g(_regions, 0), b(_regions, 0), a(_regions, 0);
+    // Each row is read from memory once and all regions that cross it are accumulated while it stays in cache
+    #pragma omp parallel
+    {
+        std::vector<unsigned long> _r(_regions, 0), _g(_regions, 0), _b(_regions, 0), _a(_regions, 0);
+        #pragma omp for
+        for(int y = _top; y < _bottom; y++) {
+            const unsigned char *p = rgbImage.ptr(y);
+            for(int k = 0; k < _regions; k++) {
+                const RegionRows &_region = _rows[k];
+                if(y < _region.top || y >= _region.bottom)
+                    continue;
+                unsigned int tB = 0, tG = 0, tR = 0;
+                for(int n = _region.offsets[y - _region.top]; n < _region.offsets[y - _region.top + 1]; n++) {
+                    accumulateColorRow(p, _region.spans[n].start, _region.spans[n].end, tB, tG, tR);
+                    _a[k] += _region.spans[n].size();
+                }
+                _b[k] += tB;
+                _g[k] += tG;
+                _r[k] += tR;
+            }
+        }
+        #pragma omp critical
+        {
+            for(int k = 0; k < _regions; k++) {
+                r[k] += _r[k];
+                g[k] += _g[k];
+                b[k] += _b[k];
+                a[k] += _a[k];
+            }
+        }
+    }
+
+    resT = static_cast<float>(1000.0*(cv::getTickCount() -  m_markTime) / cv::getTickFrequency());
+    m_markTime = cv::getTickCount();
+    v_stats.resize(_regions);
+    for(int k = 0; k < _regions; k++) {
+        RegionStats &_stats = v_stats[k];
+        _stats.red = r[k];
+        _stats.green = g[k];
+        _stats.blue = b[k];
+        _stats.area = a[k];
+        if(a[k] > regions[k].minarea) {
+            _stats.avgRed   = static_cast<float>(r[k]) / a[k];
+            _stats.avgGreen = static_cast<float>(g[k]) / a[k];
+            _stats.avgBlue  = static_cast<float>(b[k]) / a[k];
+        } else {
+            _stats.avgRed   = 0.0f;
+            _stats.avgGreen = 0.0f;
+            _stats.avgBlue  = 0.0f;
+        }
+    }
+}
+
+std::vector<EnrollRegion> FaceProcessor::getFaceQuadrants(const cv::Size &faceSize) const
+{
+    // Same geometry as enrollFace uses
+    const int W = faceSize.width, H = faceSize.height, dY = H / 30;
+    const cv::Rect _ellRect(0, -6 * dY, W, H + 6 * dY);
+    const unsigned long _minarea = static_cast<unsigned long>(m_minFaceSize.area()/8);
+    const int _top = 2 * H / 7, _middle = 3 * H / 7 + 1, _bottom = 5 * H / 7;
+    std::vector<EnrollRegion> _quadrants;
+    _quadrants.push_back(EnrollRegion(EnrollRegion::Ellipse, _ellRect, cv::Rect(W / 2 + 1, 0, std::max(0, W - W / 2 - 1), _top), _minarea));
+    _quadrants.push_back(EnrollRegion(EnrollRegion::Ellipse, _ellRect, cv::Rect(W / 2 + 1, _middle, std::max(0, W - W / 2 - 1), std::max(0, _bottom - _middle)), _minarea));
+    _quadrants.push_back(EnrollRegion(EnrollRegion::Ellipse, _ellRect, cv::Rect(0, _middle, W / 2, std::max(0, _bottom - _middle)), _minarea));
+    _quadrants.push_back(EnrollRegion(EnrollRegion::Ellipse, _ellRect, cv::Rect(0, 0, W / 2, _top), _minarea));
+    return _quadrants;
+}
+
+void FaceProcessor::buildIntegral(const cv::Mat &rgbImage)
+{
+    // 32-bit sums are faster, but they hold no more than INT_MAX/255 pixels
+    const int _sdepth = rgbImage.total() <= static_cast<size_t>(INT_MAX / 255) ? CV_32S : CV_64F;
+    cv::integral(rgbImage, m_integral, _sdepth);
+}
+
+namespace {
+template<typename T>
+void integralRectSum(const cv::Mat &integral, const cv::Rect &rect, unsigned long &blue, unsigned long &green, unsigned long &red)
+{
+    const T *_top = integral.ptr<T>(rect.y), *_bottom = integral.ptr<T>(rect.y + rect.height);
+    const int _l = 3 * rect.x, _r = 3 * (rect.x + rect.width);
+    blue  = static_cast<unsigned long>(_bottom[_r]     - _bottom[_l]     - _top[_r]     + _top[_l]);
+    green = static_cast<unsigned long>(_bottom[_r + 1] - _bottom[_l + 1] - _top[_r + 1] + _top[_l + 1]);
+    red   = static_cast<unsigned long>(_bottom[_r + 2] - _bottom[_l + 2] - _top[_r + 2] + _top[_l + 2]);
+}
+}
+
+void FaceProcessor::enrollIntegralPart(float &resRed, float &resGreen, float &resBlue, float &resT, cv::Rect roirect)
+{
+    // Table has one extra row and column
+    const cv::Rect _imageRect(0, 0, std::max(0, m_integral.cols - 1), std::max(0, m_integral.rows - 1));
+    if(roirect == cv::Rect()) {
+        roirect = _imageRect;
+    } else {
+        roirect = roirect & _imageRect;
+    }
+    unsigned long red = 0;
+    unsigned long green = 0;
+    unsigned long blue = 0;
+    const unsigned long area = static_cast<unsigned long>(roirect.area());
+    if(area > 0) {
+        if(m_integral.depth() == CV_32S)
+            integralRectSum<int>(m_integral, roirect, blue, green, red);
+        else
+            integralRectSum<double>(m_integral, roirect, blue, green, red);
+    }
+
+    resT = static_cast<float>(1000.0*(cv::getTickCount() -  m_markTime) / cv::getTickFrequency());
+    m_markTime = cv::getTickCount();
+    if(area > 16) {
+        resRed   = static_cast<float>(red)   / area;
+        resGreen = static_cast<float>(green) / area;
+        resBlue  = static_cast<float>(blue)  / area;
+    } else {
+        resRed   = 0.0f;
+        resGreen = 0.0f;
+        resBlue  = 0.0f;
+    }
+}
+
 cv::Rect FaceProcessor::__getMeanRect() const
 {
     float x = 0.0f, y = 0.0f, w = 0.0f, h = 0.0f;
@@ -328,7 +579,206 @@ void FaceProcessor::dropTimer()
 
 bool FaceProcessor::empty()
 {
-    return m_classifier.empty();
+    return pt_classifier->empty();
+}
+
+void FaceProcessor::setSkinClassifier(const SkinClassifier &classifier)
+{
+    m_skinClassifier = classifier;
+}
+
+void FaceProcessor::setClassifier(cv::CascadeClassifier *pointer)
+{
+    pt_classifier = pointer != 0 ? pointer : &m_classifier;
+}
+
+void FaceProcessor::setDetectionPeriod(unsigned int frames, double minConfidence)
+{
+    m_detectionPeriod = std::max(1u, frames);
+    m_minTrackConfidence = minConfidence;
+    m_framesSinceDetection = 0;
+    m_faceTemplate.release();
+}
+
+unsigned long FaceProcessor::getDetectionHits() const
+{
+    return m_detectionHits;
+}
+
+unsigned long FaceProcessor::getTrackingHits() const
+{
+    return m_trackingHits;
+}
+
+unsigned long FaceProcessor::getDetectorCalls() const
+{
+    return m_detectorCalls;
+}
+
+void FaceProcessor::dropCounters()
+{
+    m_detectionHits = 0;
+    m_trackingHits = 0;
+    m_detectorCalls = 0;
+}
+
+void FaceProcessor::setAsyncDetection(bool enabled)
+{
+    if(enabled == f_asyncdetection)
+        return;
+    if(enabled) {
+        // Worker is not running here, so its state could be prepared without the lock
+        m_firstGeneration = m_detectionGeneration + 1;
+        m_pendingSearch = m_localSearch;
+        f_searchpending = true;
+        f_asyncdetection = true;
+        m_detectionThread = std::thread(&FaceProcessor::__detectionLoop, this);
+    } else {
+        {
+            std::lock_guard<std::mutex> _lock(m_frameMutex);
+            f_asyncdetection = false;
+        }
+        m_frameCondition.notify_one();
+        m_detectionThread.join();
+    }
+}
+
+unsigned long FaceProcessor::getSampleGeneration() const
+{
+    return m_sampleGeneration;
+}
+
+void FaceProcessor::__postFrame(const cv::Mat &img)
+{
+    // Copy is made outside of the lock, then buffers are swapped, so the worker always gets the newest frame
+    img.copyTo(m_postedFrame);
+    {
+        std::lock_guard<std::mutex> _lock(m_frameMutex);
+        std::swap(m_postedFrame, m_pendingFrame);
+        f_framepending = true;
+    }
+    m_frameCondition.notify_one();
+}
+
+void FaceProcessor::__detectionLoop()
+{
+    cv::Mat _frame;
+    std::vector<cv::Rect> _faces;
+    LocalSearch _search; // owned by the worker, settings come through m_pendingSearch
+    while(true) {
+        {
+            std::unique_lock<std::mutex> _lock(m_frameMutex);
+            m_frameCondition.wait(_lock, [this] { return f_framepending || !f_asyncdetection; });
+            if(!f_asyncdetection)
+                return;
+            std::swap(_frame, m_pendingFrame);
+            f_framepending = false;
+            if(f_searchpending) {
+                _search = m_pendingSearch;
+                f_searchpending = false;
+            }
+        }
+        __detectFaces(_frame, _faces, _search);
+        DetectionResult &_result = m_publishedDetection.back();
+        _result.found = _faces.size() > 0;
+        _result.rect = _result.found ? _faces[0] : cv::Rect();
+        _result.generation = ++m_detectionGeneration;
+        m_publishedDetection.publish();
+    }
+}
+
+void FaceProcessor::setLocalSearch(bool enabled, unsigned int maxMisses)
+{
+    m_localSearch = LocalSearch();
+    m_localSearch.enabled = enabled;
+    m_localSearch.maxMisses = std::max(1u, maxMisses);
+    if(f_asyncdetection) {
+        std::lock_guard<std::mutex> _lock(m_frameMutex);
+        m_pendingSearch = m_localSearch;
+        f_searchpending = true;
+    }
+}
+
+void FaceProcessor::__detectFaces(const cv::Mat &img, std::vector<cv::Rect> &faces, LocalSearch &search)
+{
+    faces.clear();
+    const cv::Rect _imgRect(0, 0, img.cols, img.rows);
+    if(search.enabled && (search.lastDetection.area() > 0) && ((search.lastDetection & _imgRect) == search.lastDetection)) {
+        // Window is the last face enlarged by half of its size on each side, face size could change by 25 % only
+        const cv::Rect _window = cv::Rect(search.lastDetection.x - search.lastDetection.width / 2, search.lastDetection.y - search.lastDetection.height / 2,
+                                          2 * search.lastDetection.width, 2 * search.lastDetection.height) & _imgRect;
+        const cv::Size _maxFaceSize = m_minFaceSize*4;
+        const cv::Size _minSize(std::max(m_minFaceSize.width, search.lastDetection.width * 4 / 5), std::max(m_minFaceSize.height, search.lastDetection.height * 4 / 5));
+        const cv::Size _maxSize(std::min(_maxFaceSize.width, search.lastDetection.width * 5 / 4), std::min(_maxFaceSize.height, search.lastDetection.height * 5 / 4));
+        pt_classifier->detectMultiScale(cv::Mat(img, _window), faces, 1.3, 5, cv::CASCADE_FIND_BIGGEST_OBJECT, _minSize, _maxSize);
+        m_detectorCalls++;
+        if(faces.size() > 0) {
+            faces[0] += _window.tl();
+            search.lastDetection = faces[0];
+            search.misses = 0;
+            m_detectionHits++;
+            return;
+        }
+        search.misses++;
+        if(search.misses < search.maxMisses) {
+            // Face is still tracked, so the last detection is reported until the miss budget runs out
+            faces.push_back(search.lastDetection);
+            return;
+        }
+    }
+    pt_classifier->detectMultiScale(img, faces, 1.3, 5, cv::CASCADE_FIND_BIGGEST_OBJECT, m_minFaceSize, m_minFaceSize*4);
+    m_detectorCalls++;
+    search.misses = 0;
+    if(faces.size() > 0) {
+        search.lastDetection = faces[0];
+        m_detectionHits++;
+    } else {
+        search.lastDetection = cv::Rect();
+    }
+}
+
+void FaceProcessor::__toGray(const cv::Mat &img)
+{
+    if(img.channels() == 3)
+        cv::cvtColor(img, m_gray, cv::COLOR_BGR2GRAY);
+    else
+        m_gray = img;
+}
+
+void FaceProcessor::__updateTemplate(const cv::Mat &img, const cv::Rect &face)
+{
+    const cv::Rect _face = face & cv::Rect(0, 0, img.cols, img.rows);
+    if(_face.width < FACE_TEMPLATE_WIDTH || _face.height < FACE_TEMPLATE_WIDTH) {
+        m_faceTemplate.release();
+        return;
+    }
+    // Template is taken from the detected face only, so tracking errors do not accumulate between detections
+    const double _scale = static_cast<double>(FACE_TEMPLATE_WIDTH) / _face.width;
+    cv::resize(cv::Mat(img, _face), m_faceTemplate, cv::Size(FACE_TEMPLATE_WIDTH, cvRound(_face.height * _scale)), 0.0, 0.0, cv::INTER_AREA);
+    m_trackRect = _face;
+}
+
+bool FaceProcessor::__trackFace(const cv::Mat &img, cv::Rect &face)
+{
+    if(m_faceTemplate.empty())
+        return false;
+    // Face is searched inside the last face rect enlarged by half of its size on each side
+    const cv::Rect _window = cv::Rect(m_trackRect.x - m_trackRect.width / 2, m_trackRect.y - m_trackRect.height / 2, 2 * m_trackRect.width, 2 * m_trackRect.height)
+                             & cv::Rect(0, 0, img.cols, img.rows);
+    const double _scale = static_cast<double>(m_faceTemplate.cols) / m_trackRect.width;
+    const cv::Size _searchSize(cvRound(_window.width * _scale), cvRound(_window.height * _scale));
+    if(_searchSize.width < m_faceTemplate.cols || _searchSize.height < m_faceTemplate.rows)
+        return false;
+    cv::resize(cv::Mat(img, _window), m_search, _searchSize, 0.0, 0.0, cv::INTER_AREA);
+    cv::matchTemplate(m_search, m_faceTemplate, m_match, cv::TM_CCOEFF_NORMED);
+    double _maxVal = 0.0;
+    cv::Point _maxLoc;
+    cv::minMaxLoc(m_match, 0, &_maxVal, 0, &_maxLoc);
+    if(_maxVal < m_minTrackConfidence)
+        return false;
+    m_trackRect = cv::Rect(_window.x + cvRound(_maxLoc.x / _scale), _window.y + cvRound(_maxLoc.y / _scale), m_trackRect.width, m_trackRect.height);
+    face = m_trackRect;
+    return true;
 }
 
 void FaceProcessor::__updateRects(const cv::Rect &rect)
@@ -342,14 +792,13 @@ void FaceProcessor::__updateRects(const cv::Rect &rect)
     }
 }
 
-bool FaceProcessor::__insideEllipse(int x, int y) const
+void FaceProcessor::__updateEllipseSpans(int rows)
 {
-    float cx = (m_ellRect.x + m_ellRect.width / 2.0f - x) / (m_ellRect.width / 2.0f);
-    float cy = (m_ellRect.y + m_ellRect.height / 2.0f - y) / (m_ellRect.height / 2.0f);
-    if( (cx*cx + cy*cy) < 1.0f )
-        return true;
-    else
-        return false;
+    // Ellipse changes only with the smoothed face rect, so most of the frames reuse the spans
+    if(m_spansRect != m_ellRect || static_cast<int>(v_ellSpans.size()) != rows) {
+        computeEllipseSpans(m_ellRect, rows, v_ellSpans);
+        m_spansRect = m_ellRect;
+    }
 }
 
 cv::Rect FaceProcessor::getFaceRect() const
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2015, Taranov Alex <pi-null-mezon@yandex.ru>.
+ * Released to public domain under terms of the BSD Simplified license.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the organization nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *   See <http://www.opensource.org/licenses/bsd-license>
+ */
+#include "frameperiodestimator.h"
+
+#include <algorithm>
+
+namespace vpg {
+
+namespace {
+// Intervals that are collected before the first estimation is made
+const unsigned int WARMUP_INTERVALS = 3;
+// Running average length, the estimation follows slow changes of the frame rate within this number of frames
+const unsigned int AVERAGE_INTERVALS = 64;
+// Timestamps that do not go forward one after another before the backend is treated as one without timestamps
+const unsigned int BAD_TIMESTAMPS_LIMIT = 8;
+// Relative deviation from the integer number of periods that is still treated as lost frames
+const float FOLD_TOLERANCE = 0.2f;
+// Intervals in a row that do not match one period before the estimation is re-anchored to their median
+const unsigned int REANCHOR_INTERVALS = 5;
+}
+
+FramePeriodEstimator::FramePeriodEstimator(float initialPeriod_ms, float tolerance) :
+    m_initialPeriod(initialPeriod_ms),
+    m_tolerance(tolerance),
+    f_ticks(false)
+{
+    reset();
+}
+
+bool FramePeriodEstimator::update(double timestamp_ms)
+{
+    if(f_first) {
+        f_first = false;
+        m_lastTimestamp = timestamp_ms;
+        return false;
+    }
+    float _interval = static_cast<float>(timestamp_ms - m_lastTimestamp);
+    if(_interval <= 0.0f)
+        return false;
+    m_lastTimestamp = timestamp_ms;
+
+    if(m_intervals < WARMUP_INTERVALS) {
+        // First frames of the device could be delayed, so the median is taken
+        v_warmup[m_intervals++] = _interval;
+        if(m_intervals < WARMUP_INTERVALS)
+            return false;
+        std::sort(v_warmup, v_warmup + WARMUP_INTERVALS);
+        m_period = v_warmup[WARMUP_INTERVALS / 2];
+        m_averaged = WARMUP_INTERVALS;
+    } else {
+        const float _periods = std::round(_interval / m_period);
+        const bool _folded = (_periods >= 1.0f) && (std::abs(_interval - _periods * m_period) <= FOLD_TOLERANCE * _periods * m_period);
+        if(_folded && _periods == 1.0f) {
+            m_mismatches = 0;
+        } else {
+            // Lost frames do not happen on every frame, so a row of such intervals means the frame rate has changed
+            v_mismatches[m_mismatches++] = _interval;
+            if(m_mismatches == REANCHOR_INTERVALS) {
+                std::sort(v_mismatches, v_mismatches + REANCHOR_INTERVALS);
+                m_period = v_mismatches[REANCHOR_INTERVALS / 2];
+                m_mismatches = 0;
+                m_averaged = 1;
+                m_intervals++;
+                return __report();
+            }
+            if(!_folded) // duplicated frame or interval of unknown origin
+                return false;
+            _interval /= _periods;
+        }
+        m_intervals++;
+        m_averaged = std::min(m_averaged + 1, AVERAGE_INTERVALS);
+        m_period += (_interval - m_period) / m_averaged;
+    }
+    return __report();
+}
+
+bool FramePeriodEstimator::__report()
+{
+    if(std::abs(m_period - m_reportedPeriod) > m_tolerance * m_reportedPeriod) {
+        m_reportedPeriod = m_period;
+        return true;
+    }
+    return false;
+}
+
+bool FramePeriodEstimator::update(cv::VideoCapture *pointer)
+{
+    if(f_ticks == false) {
+        const double _timestamp = pointer->get(cv::CAP_PROP_POS_MSEC);
+        if(_timestamp > 0.0 && (f_first || _timestamp > m_lastTimestamp)) {
+            m_badTimestamps = 0;
+            return update(_timestamp);
+        }
+        // Zero or repeated timestamp is skipped, first grab or backend hiccup could give it
+        if(++m_badTimestamps < BAD_TIMESTAMPS_LIMIT)
+            return false;
+        // Backend does not provide timestamps, switch to the moments of the update() calls
+        f_ticks = true;
+        f_first = true;
+    }
+    return update(1000.0 * cv::getTickCount() / cv::getTickFrequency());
+}
+
+float FramePeriodEstimator::getPeriod() const
+{
+    return m_period;
+}
+
+bool FramePeriodEstimator::isStable() const
+{
+    return m_intervals >= WARMUP_INTERVALS;
+}
+
+unsigned int FramePeriodEstimator::getIntervals() const
+{
+    return m_intervals;
+}
+
+void FramePeriodEstimator::reset()
+{
+    m_period = m_initialPeriod;
+    m_reportedPeriod = m_initialPeriod;
+    m_lastTimestamp = 0.0;
+    m_intervals = 0;
+    m_averaged = 0;
+    m_mismatches = 0;
+    m_badTimestamps = 0;
+    f_first = true;
+    f_ticks = false;
+}
+
+} // end of namespace vpg
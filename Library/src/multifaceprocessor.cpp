@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2015, Taranov Alex <pi-null-mezon@yandex.ru>.
+ * Released to public domain under terms of the BSD Simplified license.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the organization nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *   See <http://www.opensource.org/licenses/bsd-license>
+ */
+#include "multifaceprocessor.h"
+#include "faceprocessor.h"
+#include "pixelkernels.h"
+
+#include <algorithm>
+
+#define MULTIFACE_PROCESSOR_LENGTH 33
+#define MULTIFACE_MIN_OVERLAP 0.3f
+
+namespace vpg {
+
+MultiFaceProcessor::MultiFaceProcessor(const std::string &filename, float dT_ms, unsigned int maxFaces, int totalcardiointervals) :
+    m_minFaceSize(110,110),
+    m_markTime(cv::getTickCount()),
+    m_nextId(0),
+    m_scaleX(1.0f),
+    m_scaleY(1.0f)
+{
+    loadClassifier(filename);
+    for(unsigned int i = 0; i < maxFaces; i++) {
+        v_pulsePool.push_back(new PulseProcessor(dT_ms));
+        v_peakPool.push_back(new PeakDetector(v_pulsePool.back()->getLength(), totalcardiointervals, 11, dT_ms));
+        v_pulsePool.back()->setPeakDetector(v_peakPool.back());
+        v_freeSlots.push_back(maxFaces - 1 - i);
+    }
+}
+
+MultiFaceProcessor::~MultiFaceProcessor()
+{
+    for(size_t i = 0; i < v_pulsePool.size(); i++) {
+        delete v_pulsePool[i];
+        delete v_peakPool[i];
+    }
+}
+
+void MultiFaceProcessor::enrollImage(const cv::Mat &rgbImage, float &resT)
+{
+    cv::Mat img;
+    downscaleForDetection(rgbImage, img, m_scaleX, m_scaleY);
+
+    // All faces are wanted, so biggest object flag is not used
+    std::vector<cv::Rect> detections;
+    m_classifier.detectMultiScale(img, detections, 1.3, 5, cv::CASCADE_SCALE_IMAGE, m_minFaceSize, m_minFaceSize*4);
+    __associate(detections);
+
+    for(size_t t = 0; t < v_tracks.size(); t++) {
+        const cv::Rect tempRect = __getMeanRect(v_history[t]);
+        v_tracks[t].rect = cv::Rect((int)(tempRect.x*m_scaleX), (int)(tempRect.y*m_scaleY), (int)(tempRect.width*m_scaleX), (int)(tempRect.height*m_scaleY))
+                           & cv::Rect(0, 0, rgbImage.cols, rgbImage.rows);
+    }
+    __enrollTracks(rgbImage);
+
+    resT = static_cast<float>(1000.0*(cv::getTickCount() -  m_markTime) / cv::getTickFrequency());
+    m_markTime = cv::getTickCount();
+    for(size_t t = 0; t < v_tracks.size(); t++)
+        v_tracks[t].pulseproc->update(v_tracks[t].value, resT);
+}
+
+void MultiFaceProcessor::__associate(const std::vector<cv::Rect> &detections)
+{
+    // Greedy matching, pairs with the biggest intersection over union go first
+    struct Pair
+    {
+        float overlap;
+        size_t track;
+        size_t detection;
+    };
+    std::vector<Pair> _pairs;
+    for(size_t t = 0; t < v_history.size(); t++) {
+        const cv::Rect &_last = v_history[t].lastDetection;
+        for(size_t d = 0; d < detections.size(); d++) {
+            const float _intersection = static_cast<float>((_last & detections[d]).area());
+            const float _overlap = _intersection / (_last.area() + detections[d].area() - _intersection);
+            if(_overlap > MULTIFACE_MIN_OVERLAP) {
+                Pair _pair = {_overlap, t, d};
+                _pairs.push_back(_pair);
+            }
+        }
+    }
+    std::sort(_pairs.begin(), _pairs.end(), [](const Pair &a, const Pair &b) { return a.overlap > b.overlap; });
+
+    std::vector<bool> _trackMatched(v_tracks.size(), false), _detectionMatched(detections.size(), false);
+    for(size_t i = 0; i < _pairs.size(); i++) {
+        const Pair &_pair = _pairs[i];
+        if(_trackMatched[_pair.track] || _detectionMatched[_pair.detection])
+            continue;
+        _trackMatched[_pair.track] = true;
+        _detectionMatched[_pair.detection] = true;
+        TrackHistory &_history = v_history[_pair.track];
+        _history.v_rects[_history.pos] = detections[_pair.detection];
+        _history.pos = (_history.pos + 1) % MULTIFACE_PROCESSOR_LENGTH;
+        _history.lastDetection = detections[_pair.detection];
+        v_tracks[_pair.track].misses = 0;
+    }
+
+    // Tracks that have missed the face too long are dropped and their processors are returned to the pool
+    for(size_t t = v_tracks.size(); t-- > 0;) {
+        if(!_trackMatched[t] && ++v_tracks[t].misses == MULTIFACE_PROCESSOR_LENGTH) {
+            v_freeSlots.push_back(v_history[t].slot);
+            v_tracks.erase(v_tracks.begin() + t);
+            v_history.erase(v_history.begin() + t);
+        }
+    }
+
+    for(size_t d = 0; d < detections.size(); d++) {
+        if(_detectionMatched[d] || v_freeSlots.empty())
+            continue;
+        const unsigned int _slot = v_freeSlots.back();
+        v_freeSlots.pop_back();
+        v_pulsePool[_slot]->reset();
+        v_peakPool[_slot]->reset();
+
+        TrackHistory _history;
+        _history.v_rects.assign(MULTIFACE_PROCESSOR_LENGTH, detections[d]);
+        _history.pos = 0;
+        _history.lastDetection = detections[d];
+        _history.slot = _slot;
+        v_history.push_back(_history);
+
+        FaceTrack _track;
+        _track.id = m_nextId++;
+        _track.value = 0.0f;
+        _track.misses = 0;
+        _track.pulseproc = v_pulsePool[_slot];
+        _track.peakdetector = v_peakPool[_slot];
+        v_tracks.push_back(_track);
+    }
+}
+
+void MultiFaceProcessor::__enrollTracks(const cv::Mat &rgbImage)
+{
+    // Ellipse of each face has the same geometry as FaceProcessor::enrollImage uses
+    const size_t _tracks = v_tracks.size();
+    std::vector<std::vector<cv::Range>> _spans(_tracks);
+    int _top = rgbImage.rows, _bottom = 0;
+    for(size_t t = 0; t < _tracks; t++) {
+        const cv::Rect &_face = v_tracks[t].rect;
+        if(_face.area() <= 0)
+            continue;
+        const int dX = _face.width / 16, dY = _face.height / 30;
+        computeEllipseSpans(cv::Rect(_face.x + dX, -6 * dY, _face.width - 2 * dX, _face.height + 6 * dY), _face.height, _spans[t]);
+        _top = std::min(_top, _face.y);
+        _bottom = std::max(_bottom, _face.y + _face.height);
+    }
+
+    // Single pass over the rows, all faces that cross the row are accumulated while it is in cache
+    std::vector<unsigned long> _area(_tracks, 0), _green(_tracks, 0);
+    #pragma omp parallel
+    {
+        std::vector<unsigned long> _localArea(_tracks, 0), _localGreen(_tracks, 0);
+        #pragma omp for
+        for(int y = _top; y < _bottom; y++) {
+            const unsigned char *_row = rgbImage.ptr(y);
+            for(size_t t = 0; t < _tracks; t++) {
+                const cv::Rect &_face = v_tracks[t].rect;
+                if(y < _face.y || y >= _face.y + _face.height)
+                    continue;
+                const cv::Range &_span = _spans[t][y - _face.y];
+                unsigned int _rowArea = 0, _rowGreen = 0;
+                m_skinClassifier.accumulateRow(_row, _span.start, _span.end, _rowArea, _rowGreen);
+                _localArea[t] += _rowArea;
+                _localGreen[t] += _rowGreen;
+            }
+        }
+        #pragma omp critical
+        {
+            for(size_t t = 0; t < _tracks; t++) {
+                _area[t] += _localArea[t];
+                _green[t] += _localGreen[t];
+            }
+        }
+    }
+
+    for(size_t t = 0; t < _tracks; t++) {
+        if(_area[t] > static_cast<unsigned long>(m_minFaceSize.area()/2))
+            v_tracks[t].value = static_cast<float>(_green[t]) / _area[t];
+        else
+            v_tracks[t].value = 0.0f;
+    }
+}
+
+cv::Rect MultiFaceProcessor::__getMeanRect(const TrackHistory &history) const
+{
+    float x = 0.0f, y = 0.0f, w = 0.0f, h = 0.0f;
+    for(int i = 0; i < MULTIFACE_PROCESSOR_LENGTH; i++) {
+        x += history.v_rects[i].x;
+        y += history.v_rects[i].y;
+        w += history.v_rects[i].width;
+        h += history.v_rects[i].height;
+    }
+    x /= MULTIFACE_PROCESSOR_LENGTH;
+    y /= MULTIFACE_PROCESSOR_LENGTH;
+    w /= MULTIFACE_PROCESSOR_LENGTH;
+    h /= MULTIFACE_PROCESSOR_LENGTH;
+    return cv::Rect((int)x, (int)y, (int)w, (int)h);
+}
+
+const std::vector<FaceTrack> &MultiFaceProcessor::getTracks() const
+{
+    return v_tracks;
+}
+
+bool MultiFaceProcessor::loadClassifier(const std::string &filename)
+{
+    return m_classifier.load(filename);
+}
+
+bool MultiFaceProcessor::empty()
+{
+    return m_classifier.empty();
+}
+
+void MultiFaceProcessor::dropTimer()
+{
+    m_markTime = cv::getTickCount();
+}
+
+void MultiFaceProcessor::setSkinClassifier(const SkinClassifier &classifier)
+{
+    m_skinClassifier = classifier;
+}
+
+} // end of namespace vpg
@@ -26,53 +26,57 @@ PeakDetector::PeakDetector(int _signallength, int _intervalslength, int _interva
 
 PeakDetector::~PeakDetector()
 {
-    delete[] v_S;
-    delete[] v_BS;
-    delete[] v_T;
-    delete[] v_DS;
-    delete[] v_Intervals;
 }
 
 void PeakDetector::update(float value, float time)
 {
     // Memorize signal count
-    v_S[curposforsignal] = value;
-    v_T[curposforsignal] = time;
+    v_S.push(value);
+    v_T.push(time);
 
     // Evaluate derivative with smooth
-    v_DS[curposforsignal] = ( (v_S[curposforsignal] - v_S[__loop(curposforsignal-1)]) + v_DS[__loop(curposforsignal-1)] ) / 2.0f;
+    v_DS.push( ( (v_S.last(0) - v_S.last(1)) + v_DS.last(0) ) / 2.0f );
+
+    // Binary signal is known with the delay of 2 counts, the newest ones repeat the last known state
+    v_BS.push(v_BS.last(0));
 
     // Check if derivative has crossed zero, 4 counts is used for noise protection
-    if(v_DS[curposforsignal] > 0.0 && v_DS[__loop(curposforsignal-1)] > 0.0 && v_DS[__loop(curposforsignal-3)] < 0.0 && v_DS[__loop(curposforsignal-4)] < 0.0) {
+    if(v_DS.last(0) > 0.0 && v_DS.last(1) > 0.0 && v_DS.last(3) < 0.0 && v_DS.last(4) < 0.0) {
         // Mimimun has been found
-        v_BS[__loop(curposforsignal-2)] = -1.0;
+        v_BS.setLast(2, -1.0f);
 
-    } else if(v_DS[curposforsignal] < 0.0 && v_DS[__loop(curposforsignal-1)] < 0.0 && v_DS[__loop(curposforsignal-3)] > 0.0 && v_DS[__loop(curposforsignal-4)] > 0.0) {
+    } else if(v_DS.last(0) < 0.0 && v_DS.last(1) < 0.0 && v_DS.last(3) > 0.0 && v_DS.last(4) > 0.0) {
         // Maximum has been found
-        v_BS[__loop(curposforsignal-2)] = 1.0;
+        v_BS.setLast(2, 1.0f);
 
     } else {
         // No extremum has been found
-        v_BS[__loop(curposforsignal-2)] = v_BS[__loop(curposforsignal-3)];
+        v_BS.setLast(2, v_BS.last(3));
     }
 
 
-    if(v_BS[__loop(curposforsignal-2)] == 1 && v_BS[__loop(curposforsignal-3)] == -1) {
-        __updateInterval( __getDuration(lastfrontposition, __loop(curposforsignal - 2)));
-        lastfrontposition = __loop(curposforsignal - 2);
+    if(v_BS.last(2) == 1 && v_BS.last(3) == -1) {
+        const int _front = (v_S.position() + m_signallength - 3) % m_signallength;
+        __updateInterval( __getDuration(lastfrontposition, _front));
+        lastfrontposition = _front;
     }
+}
 
-    curposforsignal = (curposforsignal + 1) % m_signallength;
+void PeakDetector::updateBatch(const float *values, const float *times, size_t n)
+{
+    // Extremum search depends on the previous decisions, so counts are processed one by one
+    for(size_t i = 0; i < n; i++)
+        update(values[i], times[i]);
 }
 
 const float *PeakDetector::getIntervalsVector() const
 {
-    return v_Intervals;
+    return v_Intervals.data();
 }
 
 const float *PeakDetector::getBinarySignal() const
 {
-    return v_BS;
+    return v_BS.data();
 }
 
 int PeakDetector::getSignalLength() const
@@ -87,12 +91,12 @@ int PeakDetector::getIntervalsLength() const
 
 float PeakDetector::getCurrentInterval() const
 {
-    return v_Intervals[__seek(curposforinterval-1)];
+    return v_Intervals.last();
 }
 
 int PeakDetector::getIntervalsPosition() const
 {
-    return curposforinterval;
+    return v_Intervals.position();
 }
 
 float PeakDetector::averageCardiointervalms(int _n) const
@@ -100,12 +104,11 @@ float PeakDetector::averageCardiointervalms(int _n) const
     if(_n == 0)
         return 0.0f;
 
-    if(_n < 0)
-        _n = getIntervalsLength();    
+    if(_n < 0 || _n > getIntervalsLength())
+        _n = getIntervalsLength();
     float _tms = 0.0f;
-    int _startpos = curposforinterval - 1;
     for(int i = 0; i < _n; ++i)
-        _tms += v_Intervals[__seek(_startpos - i)];
+        _tms += v_Intervals.last(i);
     return _tms / _n;
 }
 
@@ -124,49 +127,49 @@ float PeakDetector::computeBSI()
 
 void PeakDetector::__init(int _signallength, int _intervalslength, int _intervalssubsetvolume, float _dT_ms)
 {
-    curposforsignal = 0;
-    curposforinterval = 0;
-    lastfrontposition = 0;
     m_intervalssubsetvolume = _intervalssubsetvolume;
 
     m_signallength = _signallength;
     m_intervalslength = _intervalslength;
+    m_dTms = _dT_ms;
 
-    v_S = new float[m_signallength];
-    v_T = new float[m_signallength];
-    v_DS = new float[m_signallength];
-    v_BS = new float[m_signallength];
-    for(int i = 0; i < m_signallength; i++) {
-        v_S[i]  = 0.0f;
-        v_T[i]  = _dT_ms;
-        v_DS[i] = 0.0f;
-        v_BS[i] = 0.0f;
-    }
+    v_S.assign(m_signallength, 0.0f, true); // fronts are stored as positions of the ring
+    v_T.assign(m_signallength, m_dTms);
+    v_DS.assign(m_signallength, 0.0f);
+    v_BS.assign(m_signallength, 0.0f, true); // getBinarySignal() gives the ring order
+    v_Intervals.assign(m_intervalslength, 0.0f, true); // getIntervalsVector() gives the ring order
+
+    reset();
+}
 
-    v_Intervals = new float[m_intervalslength];
+void PeakDetector::reset()
+{
+    lastfrontposition = 0;
+
+    v_S.fill(0.0f);
+    v_T.fill(m_dTms);
+    v_DS.fill(0.0f);
+    v_BS.fill(0.0f);
+    v_Intervals.fill(0.0f);
     for(int i = 0; i < m_intervalslength; i++)
-        v_Intervals[i] = i % 2 ? 200.0f : 1000.0f;
+        v_Intervals.push(i % 2 ? 200.0f : 1000.0f);
 }
 
 void PeakDetector::__updateInterval(float _duration)
 {
     float _mean = 0.0;
     for(int i = 0; i < m_intervalssubsetvolume; i++)
-        _mean += v_Intervals[__seek(curposforinterval - 1 - i)];    
+        _mean += v_Intervals.last(i);
     _mean /= m_intervalssubsetvolume;
     float _sko = 0.0;
-    int _pos;
-    for(int i = 0; i < m_intervalssubsetvolume; i++) {
-        _pos = __seek(curposforinterval - 1 - i);
-        _sko += (v_Intervals[_pos] - _mean)*(v_Intervals[_pos] - _mean);
-    }
+    for(int i = 0; i < m_intervalssubsetvolume; i++)
+        _sko += (v_Intervals.last(i) - _mean)*(v_Intervals.last(i) - _mean);
     _sko = std::sqrt( _sko/(m_intervalssubsetvolume - 1) );
 
     if( std::abs(_duration - _mean) > (3.0f * _sko) ) {
         return;
     } else {
-        v_Intervals[curposforinterval] = _duration;
-        curposforinterval = (curposforinterval + 1) % m_intervalslength;
+        v_Intervals.push(_duration);
     }    
 }
 
@@ -174,8 +177,12 @@ float PeakDetector::__getDuration(int start, int stop)
 {
     float _duration = 0.0;
     int steps = (stop > start) ? (stop - start) : (stop + m_signallength - start);
-    for(int i = 0; i < steps; i++)
-        _duration += v_T[__loop(stop - i)];
+    // stop is the count of age 2
+    for(int i = 0, age = 2; i < steps; i++, age++) {
+        if(age == m_signallength)
+            age = 0;
+        _duration += v_T.last(age);
+    }
     return _duration;
 }
 
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2015, Taranov Alex <pi-null-mezon@yandex.ru>.
+ * Released to public domain under terms of the BSD Simplified license.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the organization nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *   See <http://www.opensource.org/licenses/bsd-license>
+ */
+#include "pixelkernels.h"
+
+#include <opencv2/core/hal/intrin.hpp>
+
+namespace vpg {
+
+void computeEllipseSpans(const cv::Rect &ellRect, int rows, std::vector<cv::Range> &spans)
+{
+    spans.resize(rows);
+    const int xMin = ellRect.x, xMax = ellRect.x + ellRect.width;
+    const float hW = ellRect.width / 2.0f, hX = ellRect.x + hW;
+    for(int j = 0; j < rows; j++) {
+        const float cy = (ellRect.y + ellRect.height / 2.0f - j) / (ellRect.height / 2.0f);
+        const float rest = 1.0f - cy*cy;
+        if(rest <= 0.0f || ellRect.width <= 0) {
+            spans[j] = cv::Range(xMin, xMin);
+            continue;
+        }
+        // Analytical guess of the chord, then refine borders by the exact test
+        const float halfchord = hW * std::sqrt(rest);
+        int xb = std::max(xMin, std::min(xMax, static_cast<int>(std::ceil(hX - halfchord))));
+        int xe = std::max(xb, std::min(xMax, static_cast<int>(std::floor(hX + halfchord)) + 1));
+        while(xb > xMin && insideEllipse(ellRect, xb - 1, j))
+            xb--;
+        while(xb < xe && !insideEllipse(ellRect, xb, j))
+            xb++;
+        while(xe < xMax && insideEllipse(ellRect, xe, j))
+            xe++;
+        while(xe > xb && !insideEllipse(ellRect, xe - 1, j))
+            xe--;
+        spans[j] = cv::Range(xb, xe);
+    }
+}
+
+void accumulateSkinRow(const unsigned char *bgr, int xBegin, int xEnd, unsigned int &area, unsigned int &green)
+{
+    unsigned int _area = 0, _green = 0;
+    int i = xBegin;
+#if CV_SIMD128
+    // Thresholds of skinRGB(), saturated R - G is 0 when G > R, so it fails the red over green test too
+    const cv::v_uint8x16 v_minRed = cv::v_setall_u8(SKIN_RED), v_minGreen = cv::v_setall_u8(SKIN_GREEN), v_minBlue = cv::v_setall_u8(SKIN_BLUE);
+    const cv::v_uint8x16 v_minRedOverGreen = cv::v_setall_u8(SKIN_RED_OVER_GREEN);
+    const cv::v_uint8x16 v_one = cv::v_setall_u8(1);
+    cv::v_uint32x4 v_area = cv::v_setzero_u32(), v_green = cv::v_setzero_u32();
+    for(; i <= xEnd - 16; i += 16) {
+        cv::v_uint8x16 vB, vG, vR;
+        cv::v_load_deinterleave(bgr + 3*i, vB, vG, vR);
+        cv::v_uint8x16 v_mask = (vR > v_minRed) & (vG > v_minGreen) & (vB > v_minBlue) & ((vR - vG) > v_minRedOverGreen);
+
+        cv::v_uint16x8 g0, g1, a0, a1;
+        cv::v_expand(vG & v_mask, g0, g1);
+        cv::v_expand(v_one & v_mask, a0, a1);
+        cv::v_uint32x4 t0, t1, t2, t3;
+        cv::v_expand(g0 + g1, t0, t1);
+        v_green += t0 + t1;
+        cv::v_expand(a0 + a1, t2, t3);
+        v_area += t2 + t3;
+    }
+    _area = cv::v_reduce_sum(v_area);
+    _green = cv::v_reduce_sum(v_green);
+#endif
+    for(; i < xEnd; i++) {
+        if(skinRGB(bgr[3*i+2], bgr[3*i+1], bgr[3*i])) {
+            _area++;
+            _green += bgr[3*i+1];
+        }
+    }
+    area += _area;
+    green += _green;
+}
+
+void accumulateColorRow(const unsigned char *bgr, int xBegin, int xEnd, unsigned int &blue, unsigned int &green, unsigned int &red)
+{
+    unsigned int _blue = 0, _green = 0, _red = 0;
+    int i = xBegin;
+#if CV_SIMD128
+    cv::v_uint32x4 v_blue = cv::v_setzero_u32(), v_green = cv::v_setzero_u32(), v_red = cv::v_setzero_u32();
+    for(; i <= xEnd - 16; i += 16) {
+        cv::v_uint8x16 vB, vG, vR;
+        cv::v_load_deinterleave(bgr + 3*i, vB, vG, vR);
+        cv::v_uint16x8 s0, s1;
+        cv::v_uint32x4 t0, t1;
+        cv::v_expand(vB, s0, s1);
+        cv::v_expand(s0 + s1, t0, t1);
+        v_blue += t0 + t1;
+        cv::v_expand(vG, s0, s1);
+        cv::v_expand(s0 + s1, t0, t1);
+        v_green += t0 + t1;
+        cv::v_expand(vR, s0, s1);
+        cv::v_expand(s0 + s1, t0, t1);
+        v_red += t0 + t1;
+    }
+    _blue = cv::v_reduce_sum(v_blue);
+    _green = cv::v_reduce_sum(v_green);
+    _red = cv::v_reduce_sum(v_red);
+#endif
+    for(; i < xEnd; i++) {
+        _blue += bgr[3*i];
+        _green += bgr[3*i+1];
+        _red += bgr[3*i+2];
+    }
+    blue += _blue;
+    green += _green;
+    red += _red;
+}
+
+} // end of namespace vpg
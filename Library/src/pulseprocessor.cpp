@@ -16,177 +16,295 @@
  *   See <http://www.opensource.org/licenses/bsd-license>
  */
 #include "pulseprocessor.h"
+#include "slidingspectrum.h"
+#include "asyncspectrum.h"
 
 namespace vpg {
 
-PulseProcessor::PulseProcessor(float dT_ms, ProcessType type)
+PulseProcessor::PulseProcessor(float dT_ms, ProcessType type, bool resample)
 {
     switch(type){
         case HeartRate:
-            __init(7500.0f, 400.0f, 350.0f, dT_ms, type);
+            __init(7500.0f, 400.0f, 350.0f, dT_ms, type, resample);
+            break;
+        case Respiration:
+            __init(30000.0f, 10000.0f, 350.0f, dT_ms, type, resample);
             break;
     }
 }
 
-PulseProcessor::PulseProcessor(float Tov_ms, float Tcn_ms, float Tlpf_ms, float dT_ms, ProcessType type)
+PulseProcessor::PulseProcessor(float Tov_ms, float Tcn_ms, float Tlpf_ms, float dT_ms, ProcessType type, bool resample)
 {
-    __init(Tov_ms, Tcn_ms, Tlpf_ms, dT_ms, type);
+    __init(Tov_ms, Tcn_ms, Tlpf_ms, dT_ms, type, resample);
 }
 
-void PulseProcessor::__init(float Tov_ms, float Tcn_ms, float Tlpf_ms, float dT_ms, ProcessType type)
+void PulseProcessor::__init(float Tov_ms, float Tcn_ms, float Tlpf_ms, float dT_ms, ProcessType type, bool resample)
 {
-    m_dTms = dT_ms;
-    m_length = static_cast<int>( Tov_ms / dT_ms );
-    m_filterlength = static_cast<int>( Tlpf_ms / dT_ms );
+    m_type = type;
+    f_resample = resample;
+    __setGeometry(Tov_ms, Tcn_ms, Tlpf_ms, dT_ms);
 
+    SpectrumSettings _settings;
     switch(type){
         case HeartRate:
-            m_Frequency = 0.0f;
-            m_interval = static_cast<int>( Tcn_ms/ dT_ms );
-            m_bottomFrequencyLimit = 0.8f; // 48 bpm
-            m_topFrequencyLimit = 2.5f;    // 150 bpm
-            break;        
+            _settings.bottomHz = 0.8f; // 48 bpm
+            _settings.topHz = 2.5f;    // 150 bpm
+            break;
+        case Respiration:
+            _settings.bottomHz = 0.1f; // 6 breaths per minute
+            _settings.topHz = 0.5f;    // 30 breaths per minute
+            break;
     }
+    __configureSpectrum(_settings);
+
+    v_raw.assign(m_length, 0.0f);
+    v_Y.assign(m_length, 0.0f, true);
+    v_time.assign(m_length, m_gridms);
+    v_X.assign(m_filterlength, 0.0f);
+
+    m_generation = 0;
+    reset();
+}
 
-    v_raw = new float[m_length];
-    v_Y = new float[m_length];
-    v_time = new float[m_length];
-    v_FA = new float[m_length/2 + 1];
+void PulseProcessor::__configureSpectrum(SpectrumSettings settings)
+{
+    // Record geometry follows the signal, other settings are kept
+    settings.length = m_length;
+    settings.warmup = m_interval;
+    settings.gridms = m_gridms;
+    settings.Tovms = m_Tovms;
+    m_estimator.configure(settings);
+    if(pt_sliding)
+        pt_sliding->invalidate();
+}
+
+SpectrumRecord PulseProcessor::__record() const
+{
+    return SpectrumRecord(v_Y.window(), v_time.window(), m_filled);
+}
 
-    for(int i = 0; i < m_length; i++)  {
-        v_raw[i] = 0.0f;
-        v_Y[i] = 0.0f;
-        v_time[i] = dT_ms;
+void PulseProcessor::__setGeometry(float Tov_ms, float Tcn_ms, float Tlpf_ms, float dT_ms)
+{
+    m_dTms = dT_ms;
+    m_Tovms = Tov_ms;
+    m_Tcnms = Tcn_ms;
+    m_Tlpfms = Tlpf_ms;
+    m_length = static_cast<int>( Tov_ms / dT_ms );
+    if(f_resample) {
+        // Internal rate is not lower than the input one and gives the length that cv::dft processes fast
+        m_length = cv::getOptimalDFTSize(m_length);
+        m_gridms = Tov_ms / m_length;
+    } else {
+        m_gridms = dT_ms;
     }
-    v_X = new float[m_filterlength];
-    for(int i = 0; i < m_filterlength; i ++)
-        v_X[i] = static_cast<float>(i);
+    m_filterlength = static_cast<int>( Tlpf_ms / m_gridms );
+    m_interval = static_cast<int>( Tcn_ms / m_gridms );
+}
 
-    v_datamat = cv::Mat(1, m_length, CV_32F);
-    v_dftmat = cv::Mat(1, m_length, CV_32F);
+void PulseProcessor::reset()
+{
+    v_raw.fill(0.0f);
+    v_Y.fill(0.0f);
+    v_time.fill(m_gridms);
+    for(int i = 0; i < m_filterlength; i ++)
+        v_X.push(static_cast<float>(i));
 
-    curpos = 0;
-    m_snr  = 0;
+    m_phase = 0.0f;
+    m_filled = 0;
+    m_estimator.reset();
+    if(pt_sliding)
+        pt_sliding->invalidate();
+    f_firstInput = true;
+    f_dirty = true;
     m_stdev = 0;
+    m_generation++;
 }
 
 PulseProcessor::~PulseProcessor()
 {
-    delete[] v_raw;
-    delete[] v_Y;
-    delete[] v_X;
-    delete[] v_time;
-    delete[] v_FA;
 }
 
 void PulseProcessor::update(float value, float time, bool filter)
 {
+    if(pt_async)
+        __takeEstimation();
+    if(filter && !(std::abs(time - m_dTms) < m_dTms))
+        time = m_dTms;
+    if(f_resample == false) {
+        __push(value, time, filter);
+        return;
+    }
+
+    if(f_firstInput) {
+        f_firstInput = false;
+        m_prevValue = value;
+        m_phase = 0.0f;
+        __push(value, m_gridms, filter);
+        return;
+    }
+    if(time <= 0.0f) {
+        m_prevValue = value;
+        return;
+    }
+    // Linear interpolation between the previous and the current counts at the moments of the internal grid
+    float _t = m_gridms - m_phase;
+    while(_t <= time) {
+        __push(m_prevValue + (value - m_prevValue) * (_t / time), m_gridms, filter);
+        _t += m_gridms;
+    }
+    m_phase = time - (_t - m_gridms);
+    m_prevValue = value;
+}
+
+void PulseProcessor::__push(float value, float time, bool filter)
+{
+    const float _outgoing = v_Y.last(m_length - 1), _outgoingTime = v_time.last(m_length - 1);
     if(filter) {
-        v_raw[curpos] = value;
-        if(std::abs(time - m_dTms) < m_dTms)
-            v_time[curpos] = time;
-        else
-            v_time[curpos] = m_dTms;       
-        float mean = 0.0, sko = 0.0;
-        for(int i = 0; i < m_interval; i++)
-            mean += v_raw[__loop(curpos - i)];
-        mean /= m_interval;
-        int pos = 0;
-        for(int i = 0; i < m_interval; i++) {
-            pos = __loop(curpos - i);
-            sko += (v_raw[pos] - mean)*(v_raw[pos] - mean);
+        const float _leaving = v_raw.last(m_interval - 1);
+        const float _dropped = v_X.last(m_filterlength - 1);
+        v_raw.push(value);
+        v_time.push(time);
+        v_X.push(0.0f);
+        float mean, sko;
+        if(f_dirty || (++m_updates >= m_length)) {
+            __anchorSums(v_raw.window() + m_length - m_interval);
+            __anchorIntegral(v_X.window());
+        } else {
+            __slideSums(value, _leaving);
+            m_integral -= _dropped;
         }
-        sko = std::sqrt( sko/(m_interval - 1));
-        m_stdev = sko;
-        if(sko < 0.01f)
-            sko = 1.0f;
-
-        v_X[__seek(curpos)] = (v_raw[curpos] - mean)/ sko;
+        __centering(mean, sko);
 
-        float integral = 0.0f;
-        for(int i = 0; i < m_filterlength; i++)
-            integral += v_X[i];
+        const float _x = (value - mean)/ sko;
+        m_integral += _x;
+        v_X.setLast(0, _x);
 
-        v_Y[curpos] = ( integral + v_Y[__loop(curpos - 1)] )  / (m_filterlength + 1.0f);
+        v_Y.push( ( static_cast<float>(m_integral) + v_Y.last() )  / (m_filterlength + 1.0f) );
     } else {
-        v_Y[curpos] = value;
-        v_time[curpos] = time;
+        v_Y.push(value);
+        v_time.push(time);
     }
 	
 	if(pt_peakdetector != 0)
-        pt_peakdetector->update(v_Y[curpos], v_time[curpos]);
+        pt_peakdetector->update(v_Y.last(), v_time.last());
 
-    curpos = (curpos + 1) % m_length;
+    if(pt_sliding)
+        pt_sliding->push(__record(), m_estimator.getSettings(), _outgoing, _outgoingTime);
+
+    if(m_filled < m_length)
+        m_filled++;
 }
 
-float PulseProcessor::computeFrequency()
+void PulseProcessor::updateBatch(const float *values, const float *times, size_t n, bool filter)
 {
-    int _zeros = 0;
-    float *pt = v_datamat.ptr<float>(0);
-    for(int i = 0; i < m_length; i++) {
-        pt[i] = v_Y[__loop(curpos - 1 - i)];
-        if(std::abs(pt[i]) <= 0.01f) {
-            _zeros++;
-        }
+    if(pt_async)
+        __takeEstimation();
+    // Block should not be longer than the part of the ring that is free from the centering window, there is no such part if Tcn_ms == Tov_ms
+    if(f_resample || !filter || m_length <= m_interval) {
+        for(size_t i = 0; i < n; i++)
+            update(values[i], times[i], filter);
+        return;
     }
-    if(_zeros > m_length/2) {
-        m_snr = -10.0f;
-        return m_Frequency;
+    const size_t _block = static_cast<size_t>(m_length - m_interval);
+    for(size_t i = 0; i < n; i += _block)
+        __pushBlock(values + i, times + i, static_cast<int>(std::min(_block, n - i)));
+}
+
+void PulseProcessor::__pushBlock(const float *values, const float *times, int n)
+{
+    v_batchT.resize(n);
+    v_batchMean.resize(n);
+    v_batchSko.resize(n);
+    v_batchY.resize(n);
+    v_batchX.resize(m_filterlength + n);
+    v_batchAnchor.resize(n);
+    float *_T = v_batchT.data(), *_mean = v_batchMean.data(), *_sko = v_batchSko.data(), *_Y = v_batchY.data();
+    // Filter history is followed by the new normalized counts
+    float *_X = v_batchX.data();
+    std::copy(v_X.window(), v_X.window() + m_filterlength, _X);
+    unsigned char *_anchor = v_batchAnchor.data();
+
+    for(int k = 0; k < n; k++)
+        _T[k] = std::abs(times[k] - m_dTms) < m_dTms ? times[k] : m_dTms;
+
+    // Running sums are serial, anchoring happens at the same counts as for the single updates
+    for(int k = 0; k < n; k++)
+        v_raw.push(values[k]);
+    const float *_raw = v_raw.window() + m_length - m_interval - n; // _raw[k] leaves the centering window when values[k] enters
+    for(int k = 0; k < n; k++) {
+        _anchor[k] = (f_dirty || (++m_updates >= m_length)) ? 1 : 0;
+        if(_anchor[k])
+            __anchorSums(_raw + k + 1);
+        else
+            __slideSums(values[k], _raw[k]);
+        __centering(_mean[k], _sko[k]);
     }
-    //cv::blur(v_datamat,v_datamat,cv::Size(3,1));
-    cv::dft(v_datamat, v_dftmat);
-    const float *v_fft = v_dftmat.ptr<const float>(0);
 
-    // complex-conjugate-symmetrical array
-    v_FA[0] = v_fft[0]*v_fft[0];
-    if((m_length % 2) == 0) { // Even number of counts
-        for(int i = 1; i < m_length/2; i++)
-            v_FA[i] = v_fft[2*i-1]*v_fft[2*i-1] + v_fft[2*i]*v_fft[2*i];
-        v_FA[m_length/2] = v_fft[m_length-1]*v_fft[m_length-1];
-    } else { // Odd number of counts
-        for(int i = 1; i <= m_length/2; i++)
-            v_FA[i] = v_fft[2*i-1]*v_fft[2*i-1] + v_fft[2*i]*v_fft[2*i];
+    for(int k = 0; k < n; k++)
+        _X[m_filterlength + k] = (values[k] - _mean[k]) / _sko[k];
+
+    for(int k = 0; k < n; k++) {
+        const float _outgoing = v_Y.last(m_length - 1), _outgoingTime = v_time.last(m_length - 1);
+        if(_anchor[k])
+            __anchorIntegral(_X + k + 1);
+        else
+            m_integral -= _X[k];
+        m_integral += _X[m_filterlength + k];
+        v_Y.push( ( static_cast<float>(m_integral) + v_Y.last() )  / (m_filterlength + 1.0f) );
+        v_time.push(_T[k]);
+        _Y[k] = v_Y.last();
+        if(pt_sliding)
+            pt_sliding->push(__record(), m_estimator.getSettings(), _outgoing, _outgoingTime);
     }
 
-    // Count time
-    float time = 0.0f;
-    for(int i = 0; i < m_length; i++)
-        time += v_time[i];
-
-    int bottom = static_cast<int>(m_bottomFrequencyLimit * time / 1000.0f);
-    int top = static_cast<int>(m_topFrequencyLimit * time / 1000.0f);
-    if(top > m_length/2)
-        top = m_length/2;
-    int i_maxpower = 0;
-    float maxpower = 0.0;
-    for(int i = bottom + 2 ; i <= top - 2; i++)
-        if( maxpower < v_FA[i] ) {
-            maxpower = v_FA[i];
-            i_maxpower = i;
-        }
+    m_filled = std::min(m_length, m_filled + n);
 
-    float noise_power = 0.0;
-    float signal_power = 0.0;
-    float signal_moment = 0.0;
-    for (int i = bottom; i <= top; i++) {
-        if ( (i >= i_maxpower - 2) && (i <= i_maxpower + 2) ) {
-            signal_power += v_FA[i];
-            signal_moment += i * v_FA[i];
-        } else {
-            noise_power += v_FA[i];
-        }
+    const int _keep = std::min(n, m_filterlength);
+    for(int k = n - _keep; k < n; k++)
+        v_X.push(_X[m_filterlength + k]);
+
+    if(pt_peakdetector != 0)
+        pt_peakdetector->updateBatch(_Y, _T, n);
+}
+
+void PulseProcessor::__anchorSums(const float *raw)
+{
+    m_sum = 0.0;
+    m_sum2 = 0.0;
+    for(int i = 0; i < m_interval; i++) {
+        const double _v = raw[i];
+        m_sum += _v;
+        m_sum2 += _v*_v;
     }
+    m_updates = 0;
+    f_dirty = false;
+}
 
-    m_snr = 0.0f;
-    if(signal_power > 0.01f && noise_power > 0.01f) {
-        m_snr = 10.0f * std::log10( signal_power / noise_power );
-        float bias = i_maxpower - ( signal_moment / signal_power );
-        m_snr *= (1.0f / (1.0f + bias*bias));
+void PulseProcessor::__anchorIntegral(const float *X)
+{
+    // The newest count is not normalized yet, so it is not counted
+    m_integral = 0.0;
+    for(int i = 0; i < m_filterlength - 1; i++)
+        m_integral += X[i];
+}
+
+float PulseProcessor::computeFrequency()
+{
+    if(pt_async && !pt_sliding) {
+        pt_async->post(__record(), m_estimator.getSettings(), m_generation);
+        __takeEstimation();
+        return getFrequency();
     }
-    if(m_snr > 2.5f)
-        m_Frequency = (signal_moment / signal_power) * 60000.0f / time;
+    if(pt_sliding && !m_estimator.isPrefix(m_filled))
+        return pt_sliding->estimate(__record(), m_estimator);
+    return m_estimator.estimate(__record());
+}
 
-    return m_Frequency;
+float PulseProcessor::computeFrequency(const float *power)
+{
+    if(pt_sliding || pt_async || getPrefixEstimation())
+        return computeFrequency();
+    return m_estimator.estimate(__record(), power);
 }
 
 int PulseProcessor::getLength() const
@@ -196,27 +314,32 @@ int PulseProcessor::getLength() const
 
 int PulseProcessor::getLastPos() const
 {
-    return __loop(curpos - 1);
+    return (v_Y.position() + m_length - 1) % m_length;
 }
 
 const float *PulseProcessor::getSignal() const
 {
-    return v_Y;
+    return v_Y.data();
+}
+
+const float *PulseProcessor::getWindow() const
+{
+    return v_Y.window();
 }
 
 float PulseProcessor::getFrequency() const
 {
-    return m_Frequency;
+    return m_estimator.getEstimate().frequency;
 }
 
 float PulseProcessor::getSNR() const
 {
-    return m_snr;
+    return m_estimator.getEstimate().snr;
 }
 
 float PulseProcessor::getSignalSampleValue() const
 {
-    return v_Y[__loop(curpos-1)];
+    return v_Y.last();
 }
 
 float PulseProcessor::getSignalStdev() const
@@ -224,6 +347,184 @@ float PulseProcessor::getSignalStdev() const
     return m_stdev;
 }
 
+void PulseProcessor::setSamplingPeriod(float dT_ms)
+{
+    if(dT_ms == m_dTms || !__validGeometry(m_Tovms, m_Tcnms, m_Tlpfms, dT_ms))
+        return;
+    if(f_resample) { // internal rate does not depend on the input one
+        m_dTms = dT_ms;
+        return;
+    }
+    m_dTms = dT_ms;
+    m_gridms = dT_ms;
+    f_dirty = true;
+    m_interval = static_cast<int>( m_Tcnms / dT_ms );
+    const int _length = static_cast<int>( m_Tovms / dT_ms );
+    const int _filterlength = static_cast<int>( m_Tlpfms / dT_ms );
+
+    if(_length != m_length) {
+        // Counts keep their own durations in v_time, so the latest of them are kept as they are
+        v_raw.resize(_length, 0.0f);
+        v_Y.resize(_length, 0.0f);
+        v_time.resize(_length, m_dTms);
+        m_length = _length;
+        m_filled = std::min(m_filled, m_length);
+    }
+    if(_filterlength != m_filterlength) {
+        v_X.resize(_filterlength, 0.0f);
+        m_filterlength = _filterlength;
+    }
+    __configureSpectrum(m_estimator.getSettings());
+}
+
+void PulseProcessor::reconfigure(float Tov_ms, float Tcn_ms, float Tlpf_ms, float dT_ms)
+{
+    if(!__validGeometry(Tov_ms, Tcn_ms, Tlpf_ms, dT_ms))
+        return;
+    if(Tov_ms == m_Tovms && Tcn_ms == m_Tcnms && Tlpf_ms == m_Tlpfms && dT_ms == m_dTms)
+        return;
+    const int _length = m_length, _filterlength = m_filterlength;
+    const std::vector<float> _raw(v_raw.window(), v_raw.window() + _length);
+    const std::vector<float> _Y(v_Y.window(), v_Y.window() + _length);
+    const std::vector<float> _time(v_time.window(), v_time.window() + _length);
+    const std::vector<float> _X(v_X.window(), v_X.window() + _filterlength);
+    float _filledms = 0.0f;
+    for(int i = _length - m_filled; i < _length; i++)
+        _filledms += _time[i];
+
+    __setGeometry(Tov_ms, Tcn_ms, Tlpf_ms, dT_ms);
+    std::vector<float> _values(m_length);
+    __resampleHistory(_raw.data(), _time.data(), _length, _values.data(), m_length);
+    v_raw.assign(m_length, 0.0f);
+    for(int i = 0; i < m_length; i++)
+        v_raw.push(_values[i]);
+    __resampleHistory(_Y.data(), _time.data(), _length, _values.data(), m_length);
+    v_Y.assign(m_length, 0.0f, true); // getSignal() gives the ring order
+    for(int i = 0; i < m_length; i++)
+        v_Y.push(_values[i]);
+    v_time.assign(m_length, m_gridms);
+    // Filter history has the same durations as the latest counts of the signal
+    _values.resize(m_filterlength);
+    __resampleHistory(_X.data(), _time.data() + _length - _filterlength, _filterlength, _values.data(), m_filterlength);
+    v_X.assign(m_filterlength, 0.0f);
+    for(int i = 0; i < m_filterlength; i++)
+        v_X.push(_values[i]);
+    m_filled = std::min(m_length, static_cast<int>(_filledms / m_gridms));
+    f_dirty = true;
+    __configureSpectrum(m_estimator.getSettings());
+}
+
+bool PulseProcessor::__validGeometry(float Tov_ms, float Tcn_ms, float Tlpf_ms, float dT_ms)
+{
+    // Filter should have one count at least, centering window two counts and both of them should fit the record
+    return dT_ms > 0.0f && Tlpf_ms >= dT_ms && Tcn_ms >= 2.0f * dT_ms && Tov_ms >= std::max(Tcn_ms, Tlpf_ms);
+}
+
+void PulseProcessor::__resampleHistory(const float *values, const float *durations, int length, float *output, int outlength) const
+{
+    // Counts are placed on the time axis backwards from the newest one, which is kept at its place,
+    // output is interpolated linearly on the internal grid, time points older than the history get zeros
+    int _age = 0;
+    float _end = 0.0f; // how long ago the count of _age was measured
+    for(int a = 0; a < outlength; a++) {
+        const float _t = a * m_gridms;
+        while(_age < length - 1 && _end + durations[length - 1 - _age] <= _t) {
+            _end += durations[length - 1 - _age];
+            _age++;
+        }
+        float _value = 0.0f;
+        if(_age < length - 1) {
+            const float _w = (_t - _end) / durations[length - 1 - _age];
+            _value = (1.0f - _w) * values[length - 1 - _age] + _w * values[length - 2 - _age];
+        } else if(_t == _end) {
+            _value = values[0];
+        }
+        output[outlength - 1 - a] = _value;
+    }
+}
+
+float PulseProcessor::getSamplingPeriod() const
+{
+    return m_dTms;
+}
+
+void PulseProcessor::setSlidingSpectrum(bool enabled)
+{
+    pt_sliding.reset(enabled ? new SlidingSpectrum() : 0);
+}
+
+bool PulseProcessor::getSlidingSpectrum() const
+{
+    return pt_sliding.get() != 0;
+}
+
+void PulseProcessor::setProgressiveEstimation(bool enabled, float minWindow_ms)
+{
+    SpectrumSettings _settings = m_estimator.getSettings();
+    _settings.progressive = enabled;
+    _settings.minWindowms = minWindow_ms;
+    m_estimator.configure(_settings);
+}
+
+PulseEstimate PulseProcessor::getEstimate() const
+{
+    return m_estimator.getEstimate();
+}
+
+void PulseProcessor::setSpectrumZoom(int zoom)
+{
+    SpectrumSettings _settings = m_estimator.getSettings();
+    _settings.zoom = std::max(1, zoom);
+    m_estimator.configure(_settings);
+}
+
+int PulseProcessor::getSpectrumZoom() const
+{
+    return m_estimator.getSettings().zoom;
+}
+
+int PulseProcessor::addBand(float bottom_Hz, float top_Hz)
+{
+    SpectrumSettings _settings = m_estimator.getSettings();
+    _settings.bands.push_back(SpectrumBand(bottom_Hz, top_Hz));
+    m_estimator.configure(_settings);
+    if(pt_sliding)
+        pt_sliding->invalidate();
+    return static_cast<int>(_settings.bands.size());
+}
+
+int PulseProcessor::getBands() const
+{
+    return static_cast<int>(m_estimator.getSettings().bands.size()) + 1;
+}
+
+PulseEstimate PulseProcessor::getEstimate(int band) const
+{
+    return m_estimator.getEstimate(band);
+}
+
+void PulseProcessor::setAsyncEstimation(bool enabled)
+{
+    if(enabled == getAsyncEstimation())
+        return;
+    pt_async.reset(enabled ? new AsyncSpectrum() : 0);
+}
+
+bool PulseProcessor::getAsyncEstimation() const
+{
+    return pt_async.get() != 0;
+}
+
+bool PulseProcessor::getPrefixEstimation() const
+{
+    return m_estimator.isPrefix(m_filled);
+}
+
+void PulseProcessor::__takeEstimation()
+{
+    pt_async->take(m_generation, m_estimator);
+}
+
 void PulseProcessor::setPeakDetector(PeakDetector *pointer)
 {
     pt_peakdetector = pointer;
@@ -0,0 +1,370 @@
+/*
+ * Copyright (c) 2015, Taranov Alex <pi-null-mezon@yandex.ru>.
+ * Released to public domain under terms of the BSD Simplified license.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the organization nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *   See <http://www.opensource.org/licenses/bsd-license>
+ */
+#include "pulseprocessorbank.h"
+
+namespace vpg {
+
+PulseProcessorBank::PulseProcessorBank(int streams, float dT_ms, PulseProcessor::ProcessType type, int intervals, int intervalssubsetvolume) :
+    m_streams(streams),
+    m_intervalslength(intervals),
+    m_intervalssubsetvolume(intervalssubsetvolume),
+    m_dTms(dT_ms)
+{
+    // Intervals are the same as PulseProcessor's default constructor uses
+    float Tov_ms = 7500.0f, Tcn_ms = 400.0f, Tlpf_ms = 350.0f;
+    switch(type){
+        case PulseProcessor::HeartRate:
+            m_bottomFrequencyLimit = 0.8f; // 48 bpm
+            m_topFrequencyLimit = 2.5f;    // 150 bpm
+            break;
+        case PulseProcessor::Respiration:
+            Tov_ms = 30000.0f;
+            Tcn_ms = 10000.0f;
+            m_bottomFrequencyLimit = 0.1f; // 6 breaths per minute
+            m_topFrequencyLimit = 0.5f;    // 30 breaths per minute
+            break;
+    }
+    m_length = static_cast<int>( Tov_ms / dT_ms );
+    m_interval = static_cast<int>( Tcn_ms / dT_ms );
+    m_filterlength = static_cast<int>( Tlpf_ms / dT_ms );
+
+    const size_t _streams = static_cast<size_t>(m_streams);
+    v_raw.resize(m_interval * _streams);
+    v_time.resize(m_length * _streams);
+    v_Y.resize(m_length * _streams);
+    v_X.resize(m_filterlength * _streams);
+    v_DS.resize(m_length * _streams);
+    v_BS.resize(m_length * _streams);
+    v_sum.resize(_streams);
+    v_sum2.resize(_streams);
+    v_integral.resize(_streams);
+    v_stdev.resize(_streams);
+    v_var.resize(_streams);
+    v_frequency.resize(_streams);
+    v_snr.resize(_streams);
+    v_front.resize(_streams);
+    v_lastfront.resize(_streams);
+    v_intervals.resize(2 * m_intervalslength * _streams);
+    v_intervalspos.resize(_streams);
+
+    v_window.resize(m_length);
+    v_FA.resize(m_length/2 + 1);
+    v_dftmat = cv::Mat(1, m_length, CV_32F);
+
+    m_pos = 0;
+    m_updates = 0;
+    m_rawpos = 0;
+    m_xpos = 0;
+    for(int s = 0; s < m_streams; s++)
+        reset(s);
+}
+
+void PulseProcessorBank::reset(int stream)
+{
+    for(int r = 0; r < m_interval; r++)
+        __row(v_raw, r)[stream] = 0.0f;
+    for(int r = 0; r < m_length; r++) {
+        __row(v_Y, r)[stream] = 0.0f;
+        __row(v_time, r)[stream] = m_dTms;
+        __row(v_DS, r)[stream] = 0.0f;
+        __row(v_BS, r)[stream] = 0.0f;
+    }
+    // Filter history gets the same values as PulseProcessor::reset() gives, from the oldest to the newest one
+    for(int r = 0; r < m_filterlength; r++)
+        __row(v_X, r)[stream] = static_cast<float>((r - m_xpos + m_filterlength) % m_filterlength);
+
+    // Intervals of the stream are stored twice, like RingBuffer does, so the latest ones are read without modulo operations
+    float *_intervals = v_intervals.data() + 2 * static_cast<size_t>(stream) * m_intervalslength;
+    for(int i = 0; i < m_intervalslength; i++) {
+        _intervals[i] = i % 2 ? 200.0f : 1000.0f;
+        _intervals[i + m_intervalslength] = _intervals[i];
+    }
+    v_intervalspos[stream] = 0;
+    // PeakDetector::reset() sets last front to 0 and rewinds its rings, so 0 is the slot of the first count after reset,
+    // rows of the bank are not rewinded, here this slot is m_pos, plain 0 would stretch the first interval of the stream
+    v_lastfront[stream] = m_pos;
+
+    v_sum[stream] = 0.0;
+    v_sum2[stream] = 0.0;
+    v_integral[stream] = 0.0;
+    v_stdev[stream] = 0.0f;
+    v_frequency[stream] = 0.0f;
+    v_snr[stream] = 0.0f;
+    f_dirty = true;
+}
+
+void PulseProcessorBank::update(const float *values, const float *times)
+{
+    const int _S = m_streams;
+    const int _prev = (m_pos + m_length - 1) % m_length;
+    float *_Y = __row(v_Y, m_pos), *_T = __row(v_time, m_pos);
+    const float *_Yprev = __row(v_Y, _prev);
+    float *_raw = __row(v_raw, m_rawpos), *_X = __row(v_X, m_xpos);
+    double *_sum = v_sum.data(), *_sum2 = v_sum2.data(), *_integral = v_integral.data();
+    float *_stdev = v_stdev.data();
+
+    // Streams do not depend on each other, loops over them are marked as simd because compiler gives up on aliasing checks of so many rows
+    if(f_dirty || (++m_updates >= m_length)) {
+        #pragma omp simd
+        for(int s = 0; s < _S; s++) {
+            _raw[s] = values[s];
+            _X[s] = 0.0f;
+        }
+        __anchor();
+    } else {
+        // Oldest counts of the centering window and of the filter history are overwritten by the new ones
+        #pragma omp simd
+        for(int s = 0; s < _S; s++) {
+            const float _leaving = _raw[s];
+            _sum[s] += static_cast<double>(values[s]) - _leaving;
+            _sum2[s] += static_cast<double>(values[s])*values[s] - static_cast<double>(_leaving)*_leaving;
+            _integral[s] -= _X[s];
+            _raw[s] = values[s];
+        }
+    }
+
+    // Square root is taken by the separate loop, it is not vectorized because of errno
+    const double _interval = m_interval;
+    double *_var = v_var.data();
+    #pragma omp simd
+    for(int s = 0; s < _S; s++)
+        _var[s] = std::max(0.0, (_sum2[s] - _sum[s]*_sum[s]/_interval) / (_interval - 1.0));
+    for(int s = 0; s < _S; s++)
+        _stdev[s] = static_cast<float>(std::sqrt(_var[s]));
+
+    const float _norm = m_filterlength + 1.0f, _dT = m_dTms;
+    #pragma omp simd
+    for(int s = 0; s < _S; s++) {
+        const float _t = times[s];
+        const float mean = static_cast<float>(_sum[s] / _interval);
+        const float sko = _stdev[s] < 0.01f ? 1.0f : _stdev[s];
+        const float _x = (values[s] - mean) / sko;
+        _integral[s] += _x;
+        _X[s] = _x;
+        _Y[s] = ( static_cast<float>(_integral[s]) + _Yprev[s] ) / _norm;
+        _T[s] = std::abs(_t - _dT) < _dT ? _t : _dT;
+    }
+
+    __peaks(_Y);
+
+    if(++m_pos == m_length)
+        m_pos = 0;
+    if(++m_rawpos == m_interval)
+        m_rawpos = 0;
+    if(++m_xpos == m_filterlength)
+        m_xpos = 0;
+}
+
+void PulseProcessorBank::__anchor()
+{
+    // Rows are summed from the oldest to the newest one, so the sums are the same as PulseProcessor's ones
+    const int _S = m_streams;
+    double *_sum = v_sum.data(), *_sum2 = v_sum2.data(), *_integral = v_integral.data();
+    std::fill(v_sum.begin(), v_sum.end(), 0.0);
+    std::fill(v_sum2.begin(), v_sum2.end(), 0.0);
+    std::fill(v_integral.begin(), v_integral.end(), 0.0);
+    for(int i = 1; i <= m_interval; i++) {
+        const float *_raw = __row(v_raw, (m_rawpos + i) % m_interval);
+        for(int s = 0; s < _S; s++) {
+            const double _v = _raw[s];
+            _sum[s] += _v;
+            _sum2[s] += _v*_v;
+        }
+    }
+    // The newest count is not normalized yet, so it is not counted
+    for(int i = 1; i < m_filterlength; i++) {
+        const float *_X = __row(v_X, (m_xpos + i) % m_filterlength);
+        for(int s = 0; s < _S; s++)
+            _integral[s] += _X[s];
+    }
+    m_updates = 0;
+    f_dirty = false;
+}
+
+void PulseProcessorBank::__peaks(const float *Y)
+{
+    // The same extremum search as PeakDetector::update() does, rows are addressed by the age of the count
+    const int _S = m_streams;
+    const int N = m_length;
+    const float *_Yprev = __row(v_Y, (m_pos + N - 1) % N);
+    float *_DS0 = __row(v_DS, m_pos), *_BS0 = __row(v_BS, m_pos);
+    const float *_DS1 = __row(v_DS, (m_pos + N - 1) % N), *_BS1 = __row(v_BS, (m_pos + N - 1) % N);
+    const float *_DS3 = __row(v_DS, (m_pos + N - 3) % N), *_BS3 = __row(v_BS, (m_pos + N - 3) % N);
+    const float *_DS4 = __row(v_DS, (m_pos + N - 4) % N);
+    float *_BS2 = __row(v_BS, (m_pos + N - 2) % N);
+    unsigned char *_front = v_front.data();
+    unsigned char _fronts = 0;
+    #pragma omp simd reduction(|:_fronts)
+    for(int s = 0; s < _S; s++) {
+        const float _ds1 = _DS1[s], _ds3 = _DS3[s], _ds4 = _DS4[s], _bs3 = _BS3[s];
+        const float _ds = ( (Y[s] - _Yprev[s]) + _ds1 ) / 2.0f;
+        _DS0[s] = _ds;
+        _BS0[s] = _BS1[s];
+        // Conditions are combined without short circuits, so the loop has no branches
+        const int _minimum = (_ds > 0.0f) & (_ds1 > 0.0f) & (_ds3 < 0.0f) & (_ds4 < 0.0f);
+        const int _maximum = (_ds < 0.0f) & (_ds1 < 0.0f) & (_ds3 > 0.0f) & (_ds4 > 0.0f);
+        float _bs = _maximum ? 1.0f : _bs3;
+        _bs = _minimum ? -1.0f : _bs;
+        _BS2[s] = _bs;
+        _front[s] = static_cast<unsigned char>((_bs == 1.0f) & (_bs3 == -1.0f));
+        _fronts |= _front[s];
+    }
+    if(_fronts == 0)
+        return;
+
+    const int _pos = (m_pos + N - 2) % N;
+    for(int s = 0; s < _S; s++)
+        if(_front[s]) {
+            __updateInterval(s, __getDuration(s, v_lastfront[s], _pos));
+            v_lastfront[s] = _pos;
+        }
+}
+
+float PulseProcessorBank::__getDuration(int stream, int start, int stop) const
+{
+    float _duration = 0.0f;
+    const int steps = (stop > start) ? (stop - start) : (stop + m_length - start);
+    for(int i = 0, r = stop; i < steps; i++, r--) {
+        if(r < 0)
+            r += m_length;
+        _duration += __row(v_time, r)[stream];
+    }
+    return _duration;
+}
+
+void PulseProcessorBank::__updateInterval(int stream, float _duration)
+{
+    float *_intervals = v_intervals.data() + 2 * static_cast<size_t>(stream) * m_intervalslength;
+    int &_pos = v_intervalspos[stream];
+    const float *_last = _intervals + _pos + m_intervalslength - 1; // _last[-age]
+    float _mean = 0.0;
+    for(int i = 0; i < m_intervalssubsetvolume; i++)
+        _mean += _last[-i];
+    _mean /= m_intervalssubsetvolume;
+    float _sko = 0.0;
+    for(int i = 0; i < m_intervalssubsetvolume; i++)
+        _sko += (_last[-i] - _mean)*(_last[-i] - _mean);
+    _sko = std::sqrt( _sko/(m_intervalssubsetvolume - 1) );
+
+    if( std::abs(_duration - _mean) > (3.0f * _sko) )
+        return;
+    _intervals[_pos] = _duration;
+    _intervals[_pos + m_intervalslength] = _duration;
+    if(++_pos == m_intervalslength)
+        _pos = 0;
+}
+
+float PulseProcessorBank::computeFrequency(int stream)
+{
+    return __computeFrequency(stream, v_window.data(), v_FA.data(), v_dftmat);
+}
+
+void PulseProcessorBank::computeFrequencies()
+{
+    #pragma omp parallel
+    {
+        std::vector<float> _window(m_length), _power(m_length/2 + 1);
+        cv::Mat _dftmat(1, m_length, CV_32F);
+        #pragma omp for
+        for(int s = 0; s < m_streams; s++)
+            __computeFrequency(s, _window.data(), _power.data(), _dftmat);
+    }
+}
+
+float PulseProcessorBank::__computeFrequency(int stream, float *window, float *power, cv::Mat &dftmat)
+{
+    int _zeros = 0;
+    for(int i = 0; i < m_length; i++) {
+        window[i] = __row(v_Y, (m_pos + i) % m_length)[stream];
+        if(std::abs(window[i]) <= 0.01f)
+            _zeros++;
+    }
+    if(_zeros > m_length/2) {
+        v_snr[stream] = -10.0f;
+        return v_frequency[stream];
+    }
+    const cv::Mat _datamat(1, m_length, CV_32F, window);
+    cv::dft(_datamat, dftmat);
+    powerSpectrum(dftmat.ptr<const float>(0), m_length, power);
+
+    float time = 0.0f;
+    for(int r = 0; r < m_length; r++)
+        time += __row(v_time, r)[stream];
+    const int bottom = static_cast<int>(m_bottomFrequencyLimit * time / 1000.0f);
+    const int top = std::min(m_length/2, static_cast<int>(m_topFrequencyLimit * time / 1000.0f));
+
+    estimatePulseFrequency(power, bottom, top, time, v_frequency[stream], v_snr[stream]);
+    return v_frequency[stream];
+}
+
+int PulseProcessorBank::streams() const
+{
+    return m_streams;
+}
+
+int PulseProcessorBank::getLength() const
+{
+    return m_length;
+}
+
+float PulseProcessorBank::getFrequency(int stream) const
+{
+    return v_frequency[stream];
+}
+
+float PulseProcessorBank::getSNR(int stream) const
+{
+    return v_snr[stream];
+}
+
+float PulseProcessorBank::getSignalSampleValue(int stream) const
+{
+    return __row(v_Y, (m_pos + m_length - 1) % m_length)[stream];
+}
+
+float PulseProcessorBank::getSignalStdev(int stream) const
+{
+    return v_stdev[stream];
+}
+
+void PulseProcessorBank::getSignal(int stream, float *signal) const
+{
+    for(int i = 0; i < m_length; i++)
+        signal[i] = __row(v_Y, (m_pos + i) % m_length)[stream];
+}
+
+float PulseProcessorBank::getCurrentInterval(int stream) const
+{
+    return v_intervals[2 * static_cast<size_t>(stream) * m_intervalslength + v_intervalspos[stream] + m_intervalslength - 1];
+}
+
+float PulseProcessorBank::averageCardiointervalms(int stream, int _n) const
+{
+    if(_n == 0)
+        return 0.0f;
+
+    if(_n < 0 || _n > m_intervalslength)
+        _n = m_intervalslength;
+    const float *_last = v_intervals.data() + 2 * static_cast<size_t>(stream) * m_intervalslength + v_intervalspos[stream] + m_intervalslength - 1;
+    float _tms = 0.0f;
+    for(int i = 0; i < _n; ++i)
+        _tms += _last[-i];
+    return _tms / _n;
+}
+
+} // end of namespace vpg
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2015, Taranov Alex <pi-null-mezon@yandex.ru>.
+ * Released to public domain under terms of the BSD Simplified license.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the organization nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *   See <http://www.opensource.org/licenses/bsd-license>
+ */
+#include "skinclassifier.h"
+#include "pixelkernels.h"
+
+namespace vpg {
+
+SkinClassifier::SkinClassifier(ColorRule rule) :
+    m_rule(rule)
+{
+    if(m_rule == Custom) // there is no predicate to build table from
+        m_rule = RGB;
+    m_table = __getTable(m_rule);
+    pt_table = m_table->data();
+}
+
+SkinClassifier::SkinClassifier(const std::function<bool (unsigned char, unsigned char, unsigned char)> &rule) :
+    m_rule(Custom)
+{
+    m_table = __makeTable(rule);
+    pt_table = m_table->data();
+}
+
+void SkinClassifier::accumulateRow(const unsigned char *bgr, int xBegin, int xEnd, unsigned int &area, unsigned int &green) const
+{
+    if(m_rule == RGB) {
+        accumulateSkinRow(bgr, xBegin, xEnd, area, green);
+        return;
+    }
+    unsigned int _area = 0, _green = 0, _skin;
+    for(int i = xBegin; i < xEnd; i++) {
+        _skin = __lookup(bgr[3*i+2], bgr[3*i+1], bgr[3*i]);
+        _area += _skin;
+        _green += _skin * bgr[3*i+1];
+    }
+    area += _area;
+    green += _green;
+}
+
+void SkinClassifier::threshold(const cv::Mat &inputArray, cv::Mat &outputArray, unsigned char minVal, unsigned char maxVal) const
+{
+    outputArray.create(inputArray.rows, inputArray.cols, CV_8UC1);
+    const int delta = static_cast<int>(maxVal) - minVal;
+    #pragma omp parallel for
+    for(int y = 0; y < inputArray.rows; y++) {
+        const unsigned char *p_input = inputArray.ptr<const unsigned char>(y);
+        unsigned char *p_output = outputArray.ptr(y);
+        for(int x = 0; x < inputArray.cols; x++)
+            p_output[x] = static_cast<unsigned char>(minVal + delta * static_cast<int>(__lookup(p_input[x*3+2], p_input[x*3+1], p_input[x*3])));
+    }
+}
+
+SkinClassifier::ColorRule SkinClassifier::getRule() const
+{
+    return m_rule;
+}
+
+bool SkinClassifier::ruleRGB(unsigned char vR, unsigned char vG, unsigned char vB)
+{
+    return skinRGB(vR, vG, vB);
+}
+
+bool SkinClassifier::ruleYCbCr(unsigned char vR, unsigned char vG, unsigned char vB)
+{
+    // Chai and Ngan skin color map, ITU-R BT.601 full range conversion
+    const float Y = 0.299f*vR + 0.587f*vG + 0.114f*vB;
+    const float Cr = (vR - Y)*0.713f + 128.0f;
+    const float Cb = (vB - Y)*0.564f + 128.0f;
+    if( (Cb >= 77.0f) && (Cb <= 127.0f) && (Cr >= 133.0f) && (Cr <= 173.0f) )
+        return true;
+    else
+        return false;
+}
+
+bool SkinClassifier::ruleHSV(unsigned char vR, unsigned char vG, unsigned char vB)
+{
+    // Hue in [0, 50] degrees, saturation in [0.23, 0.68], not too dark
+    const int max = std::max(vR, std::max(vG, vB));
+    const int min = std::min(vR, std::min(vG, vB));
+    if(max == 0 || max == min || max != vR)
+        return false;
+    const float S = static_cast<float>(max - min) / max;
+    const float H = 60.0f * (static_cast<int>(vG) - vB) / (max - min);
+    if( (H >= 0.0f) && (H <= 50.0f) && (S >= 0.23f) && (S <= 0.68f) && (max > 89) )
+        return true;
+    else
+        return false;
+}
+
+std::shared_ptr<const std::vector<unsigned char>> SkinClassifier::__makeTable(const std::function<bool (unsigned char, unsigned char, unsigned char)> &rule)
+{
+    std::shared_ptr<std::vector<unsigned char>> _table = std::make_shared<std::vector<unsigned char>>((1 << 24) / 8, 0);
+    unsigned char *_ptr = _table->data();
+    #pragma omp parallel for
+    for(int r = 0; r < 256; r++) {
+        for(int g = 0; g < 256; g++) {
+            // 256 blue values of the same (r,g) occupy 32 whole bytes, so threads never share a byte
+            unsigned char *_bytes = _ptr + (((r << 16) | (g << 8)) >> 3);
+            for(int b = 0; b < 256; b++)
+                if(rule(static_cast<unsigned char>(r), static_cast<unsigned char>(g), static_cast<unsigned char>(b)))
+                    _bytes[b >> 3] |= static_cast<unsigned char>(1 << (b & 7));
+        }
+    }
+    return _table;
+}
+
+std::shared_ptr<const std::vector<unsigned char>> SkinClassifier::__getTable(ColorRule rule)
+{
+    switch(rule) {
+        case YCbCr: {
+            static const std::shared_ptr<const std::vector<unsigned char>> _table = __makeTable(ruleYCbCr);
+            return _table;
+        }
+        case HSV: {
+            static const std::shared_ptr<const std::vector<unsigned char>> _table = __makeTable(ruleHSV);
+            return _table;
+        }
+        default: {
+            static const std::shared_ptr<const std::vector<unsigned char>> _table = __makeTable(ruleRGB);
+            return _table;
+        }
+    }
+}
+
+} // end of namespace vpg
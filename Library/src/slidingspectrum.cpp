@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2015, Taranov Alex <pi-null-mezon@yandex.ru>.
+ * Released to public domain under terms of the BSD Simplified license.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the organization nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *   See <http://www.opensource.org/licenses/bsd-license>
+ */
+#include "slidingspectrum.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace vpg {
+
+SlidingSpectrum::SlidingSpectrum() :
+    f_dirty(true),
+    m_length(0),
+    m_first(0),
+    m_last(0),
+    m_updates(0),
+    m_zeros(0),
+    m_recordTime(0.0)
+{
+}
+
+void SlidingSpectrum::invalidate()
+{
+    f_dirty = true;
+}
+
+void SlidingSpectrum::__computeBins(const SpectrumRecord &record, int length, int first, int last)
+{
+    m_length = length;
+    m_first = first;
+    m_last = last;
+    const size_t _bins = static_cast<size_t>(last - first + 1);
+    v_re.assign(_bins, 0.0);
+    v_im.assign(_bins, 0.0);
+    v_cos.resize(_bins);
+    v_sin.resize(_bins);
+    v_power.resize(length/2 + 1);
+    const double _step = 2.0 * CV_PI / length;
+    const float *_Y = record.signal, *_time = record.time;
+    for(size_t i = 0; i < _bins; i++) {
+        const int k = first + static_cast<int>(i);
+        v_cos[i] = std::cos(_step * k);
+        v_sin[i] = std::sin(_step * k);
+        double _re = 0.0, _im = 0.0;
+        for(int m = 0; m < length; m++) { // oldest count goes first
+            const double _x = _Y[m];
+            const double _phase = _step * ((static_cast<long>(k) * m) % length);
+            _re += _x * std::cos(_phase);
+            _im -= _x * std::sin(_phase);
+        }
+        v_re[i] = _re;
+        v_im[i] = _im;
+    }
+    m_zeros = 0;
+    m_recordTime = 0.0;
+    for(int i = 0; i < length; i++) {
+        if(std::abs(_Y[i]) <= 0.01f)
+            m_zeros++;
+        m_recordTime += _time[i];
+    }
+    m_updates = 0;
+    f_dirty = false;
+}
+
+void SlidingSpectrum::push(const SpectrumRecord &record, const SpectrumSettings &settings, float outgoing, float outgoingTime)
+{
+    if(f_dirty) {
+        float _bottom, _top;
+        settings.bandsLimits(_bottom, _top);
+        int _first, _last;
+        settings.nominalBins(_bottom, _top, _first, _last);
+        __computeBins(record, settings.length, _first, _last);
+        return;
+    }
+    if(++m_updates >= m_length) { // drop accumulated rounding error
+        __computeBins(record, m_length, m_first, m_last);
+        return;
+    }
+    const float _incoming = record.signal[m_length - 1];
+    m_zeros += (std::abs(_incoming) <= 0.01f ? 1 : 0) - (std::abs(outgoing) <= 0.01f ? 1 : 0);
+    m_recordTime += static_cast<double>(record.time[m_length - 1]) - outgoingTime;
+    // X[k] = (X[k] - x_old + x_new) * exp(j*2*pi*k/N)
+    const double _delta = static_cast<double>(_incoming) - outgoing;
+    for(size_t i = 0; i < v_re.size(); i++) {
+        const double _re = v_re[i] + _delta, _im = v_im[i];
+        v_re[i] = _re*v_cos[i] - _im*v_sin[i];
+        v_im[i] = _re*v_sin[i] + _im*v_cos[i];
+    }
+}
+
+float SlidingSpectrum::estimate(const SpectrumRecord &record, SpectrumEstimator &estimator)
+{
+    const SpectrumSettings &_settings = estimator.getSettings();
+    // Bins cover all of the bands
+    float _bottom, _top;
+    _settings.bandsLimits(_bottom, _top);
+    int bottom, top;
+    if(f_dirty) {
+        _settings.nominalBins(_bottom, _top, bottom, top);
+        __computeBins(record, _settings.length, bottom, top);
+    }
+    if(m_zeros > m_length/2)
+        return estimator.sparse();
+    const float time = static_cast<float>(m_recordTime);
+    bottom = static_cast<int>(_bottom * time / 1000.0f);
+    top = static_cast<int>(_top * time / 1000.0f);
+    if(top > m_length/2)
+        top = m_length/2;
+    if(bottom < m_first || top > m_last) // record duration has drifted out of the tracked bins
+        __computeBins(record, m_length, std::min(bottom, m_first), std::max(top, m_last));
+    for(int i = bottom; i <= top; i++) {
+        const int k = i - m_first;
+        v_power[i] = static_cast<float>(v_re[k]*v_re[k] + v_im[k]*v_im[k]);
+    }
+    return estimator.estimateByPower(v_power.data(), time, record.signal, time);
+}
+
+} // end of namespace vpg
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2015, Taranov Alex <pi-null-mezon@yandex.ru>.
+ * Released to public domain under terms of the BSD Simplified license.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the organization nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *   See <http://www.opensource.org/licenses/bsd-license>
+ */
+#include "spectrumengine.h"
+
+#include <algorithm>
+
+namespace vpg {
+
+SpectrumEngine::SpectrumEngine()
+{
+}
+
+void SpectrumEngine::add(PulseProcessor *processor)
+{
+    if(std::find(v_processors.begin(), v_processors.end(), processor) == v_processors.end())
+        v_processors.push_back(processor);
+}
+
+bool SpectrumEngine::remove(PulseProcessor *processor)
+{
+    std::vector<PulseProcessor*>::iterator _it = std::find(v_processors.begin(), v_processors.end(), processor);
+    if(_it == v_processors.end())
+        return false;
+    v_processors.erase(_it);
+    return true;
+}
+
+size_t SpectrumEngine::size() const
+{
+    return v_processors.size();
+}
+
+void SpectrumEngine::compute()
+{
+    compute(v_processors.data(), v_processors.size());
+}
+
+void SpectrumEngine::compute(PulseProcessor *const *processors, size_t n)
+{
+    v_order.clear();
+    for(size_t i = 0; i < n; i++) {
+        // These processors do not use the shared DFT, so it is not computed for them
+        if(processors[i]->getSlidingSpectrum() || processors[i]->getAsyncEstimation() || processors[i]->getPrefixEstimation())
+            processors[i]->computeFrequency();
+        else
+            v_order.push_back(processors[i]);
+    }
+    // Signal length could differ (see PulseProcessor::setSamplingPeriod), each length gets own matrix
+    std::stable_sort(v_order.begin(), v_order.end(), [](const PulseProcessor *a, const PulseProcessor *b) {
+        return a->getLength() < b->getLength();
+    });
+    for(size_t i = 0; i < v_order.size();) {
+        const int _length = v_order[i]->getLength();
+        size_t j = i + 1;
+        while(j < v_order.size() && v_order[j]->getLength() == _length)
+            j++;
+        __computeRows(v_order.data() + i, static_cast<int>(j - i), _length);
+        i = j;
+    }
+}
+
+void SpectrumEngine::__computeRows(PulseProcessor *const *processors, int rows, int length)
+{
+    m_windows.create(rows, length, CV_32F);
+    for(int i = 0; i < rows; i++)
+        std::copy(processors[i]->getWindow(), processors[i]->getWindow() + length, m_windows.ptr<float>(i));
+
+    cv::dft(m_windows, m_spectrums, cv::DFT_ROWS);
+
+    m_power.create(rows, length/2 + 1, CV_32F);
+    for(int i = 0; i < rows; i++)
+        powerSpectrum(m_spectrums.ptr<const float>(i), length, m_power.ptr<float>(i));
+    for(int i = 0; i < rows; i++)
+        processors[i]->computeFrequency(m_power.ptr<const float>(i));
+}
+
+} // end of namespace vpg
@@ -0,0 +1,393 @@
+/*
+ * Copyright (c) 2015, Taranov Alex <pi-null-mezon@yandex.ru>.
+ * Released to public domain under terms of the BSD Simplified license.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the organization nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *   See <http://www.opensource.org/licenses/bsd-license>
+ */
+#include "spectrumestimator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace vpg {
+
+void powerSpectrum(const float *ccs, int length, float *power)
+{
+    // complex-conjugate-symmetrical array
+    power[0] = ccs[0]*ccs[0];
+    if((length % 2) == 0) { // Even number of counts
+        for(int i = 1; i < length/2; i++)
+            power[i] = ccs[2*i-1]*ccs[2*i-1] + ccs[2*i]*ccs[2*i];
+        power[length/2] = ccs[length-1]*ccs[length-1];
+    } else { // Odd number of counts
+        for(int i = 1; i <= length/2; i++)
+            power[i] = ccs[2*i-1]*ccs[2*i-1] + ccs[2*i]*ccs[2*i];
+    }
+}
+
+bool estimatePulseFrequency(const float *power, int bottom, int top, float time_ms, float &frequency, float &snr)
+{
+    int i_maxpower = 0;
+    float maxpower = 0.0;
+    for(int i = bottom + 2 ; i <= top - 2; i++)
+        if( maxpower < power[i] ) {
+            maxpower = power[i];
+            i_maxpower = i;
+        }
+
+    float noise_power = 0.0;
+    float signal_power = 0.0;
+    float signal_moment = 0.0;
+    for (int i = bottom; i <= top; i++) {
+        if ( (i >= i_maxpower - 2) && (i <= i_maxpower + 2) ) {
+            signal_power += power[i];
+            signal_moment += i * power[i];
+        } else {
+            noise_power += power[i];
+        }
+    }
+
+    snr = 0.0f;
+    if(signal_power > 0.01f && noise_power > 0.01f) {
+        snr = 10.0f * std::log10( signal_power / noise_power );
+        float bias = i_maxpower - ( signal_moment / signal_power );
+        snr *= (1.0f / (1.0f + bias*bias));
+    }
+    if(snr > 2.5f) {
+        frequency = (signal_moment / signal_power) * 60000.0f / time_ms;
+        return true;
+    }
+    return false;
+}
+
+SpectrumSettings::SpectrumSettings() :
+    length(0),
+    warmup(0),
+    gridms(0.0f),
+    Tovms(0.0f),
+    bottomHz(0.0f),
+    topHz(0.0f),
+    zoom(1),
+    progressive(false),
+    minWindowms(2000.0f)
+{
+}
+
+bool SpectrumSettings::operator==(const SpectrumSettings &other) const
+{
+    if(bands.size() != other.bands.size())
+        return false;
+    for(size_t i = 0; i < bands.size(); i++)
+        if(bands[i].bottom != other.bands[i].bottom || bands[i].top != other.bands[i].top)
+            return false;
+    return length == other.length && warmup == other.warmup && gridms == other.gridms && Tovms == other.Tovms
+            && bottomHz == other.bottomHz && topHz == other.topHz && zoom == other.zoom
+            && progressive == other.progressive && minWindowms == other.minWindowms;
+}
+
+bool SpectrumSettings::operator!=(const SpectrumSettings &other) const
+{
+    return !(*this == other);
+}
+
+void SpectrumSettings::bandsLimits(float &bottom_Hz, float &top_Hz) const
+{
+    bottom_Hz = bottomHz;
+    top_Hz = topHz;
+    for(size_t i = 0; i < bands.size(); i++) {
+        bottom_Hz = std::min(bottom_Hz, bands[i].bottom);
+        top_Hz = std::max(top_Hz, bands[i].top);
+    }
+}
+
+void SpectrumSettings::nominalBins(float bottom_Hz, float top_Hz, int &first, int &last) const
+{
+    // Margins leave room for the record duration variations, so bins are rarely retracked
+    const float _time = length * gridms;
+    first = std::max(0, static_cast<int>(0.7f * bottom_Hz * _time / 1000.0f));
+    last = std::min(length/2, static_cast<int>(1.3f * top_Hz * _time / 1000.0f) + 1);
+}
+
+SpectrumEstimator::SpectrumEstimator() :
+    v_estimates(1)
+{
+}
+
+SpectrumEstimator::~SpectrumEstimator()
+{
+}
+
+void SpectrumEstimator::configure(const SpectrumSettings &settings)
+{
+    const bool _geometry = settings.length != m_settings.length || settings.gridms != m_settings.gridms
+                           || settings.bottomHz != m_settings.bottomHz || settings.topHz != m_settings.topHz;
+    if(settings.length != m_settings.length) {
+        v_power.resize(settings.length/2 + 1);
+        v_dftmat = cv::Mat(1, settings.length, CV_32F);
+    }
+    if(settings.zoom != m_settings.zoom || !pt_zoom)
+        pt_zoom.reset(settings.zoom > 1 ? new ZoomSpectrum(settings.zoom) : 0);
+    else if(_geometry)
+        pt_zoom->invalidate();
+    if(!settings.progressive)
+        pt_prefix.reset();
+    else if(!pt_prefix)
+        pt_prefix.reset(new PrefixSpectrum(settings.minWindowms));
+    else
+        pt_prefix->setMinWindow(settings.minWindowms);
+    v_estimates.resize(settings.bands.size() + 1);
+    m_settings = settings;
+}
+
+const SpectrumSettings &SpectrumEstimator::getSettings() const
+{
+    return m_settings;
+}
+
+void SpectrumEstimator::reset()
+{
+    std::fill(v_estimates.begin(), v_estimates.end(), PulseEstimate());
+}
+
+bool SpectrumEstimator::isPrefix(int filled) const
+{
+    return pt_prefix && (filled < m_settings.length);
+}
+
+float SpectrumEstimator::estimate(const SpectrumRecord &record)
+{
+    if(isPrefix(record.filled))
+        return pt_prefix->estimate(record, *this);
+    // Power spectrum does not depend on the samples order, so the record is transformed without copying
+    const int _length = m_settings.length;
+    if(isSparse(record.signal, _length))
+        return sparse();
+    const cv::Mat _datamat(1, _length, CV_32F, const_cast<float*>(record.signal));
+    cv::dft(_datamat, v_dftmat);
+    powerSpectrum(v_dftmat.ptr<const float>(0), _length, v_power.data());
+    const float _time = __recordTime(record);
+    return estimateByPower(v_power.data(), _time, record.signal, _time);
+}
+
+float SpectrumEstimator::estimate(const SpectrumRecord &record, const float *power)
+{
+    if(isSparse(record.signal, m_settings.length))
+        return sparse();
+    const float _time = __recordTime(record);
+    return estimateByPower(power, _time, record.signal, _time);
+}
+
+float SpectrumEstimator::__recordTime(const SpectrumRecord &record) const
+{
+    float _time = 0.0f;
+    for(int i = 0; i < m_settings.length; i++)
+        _time += record.time[i];
+    return _time;
+}
+
+float SpectrumEstimator::estimateByPower(const float *power, float time, const float *signal, float window)
+{
+    const int _half = m_settings.length/2;
+    PulseEstimate &_main = v_estimates[0];
+    const int bottom = static_cast<int>(m_settings.bottomHz * time / 1000.0f);
+    const int top = std::min(_half, static_cast<int>(m_settings.topHz * time / 1000.0f));
+    if(estimatePulseFrequency(power, bottom, top, time, _main.frequency, _main.snr)) {
+        if(pt_zoom)
+            _main.frequency = pt_zoom->refine(m_settings, _main.frequency, bottom, top, time, signal);
+        _main.window = window;
+        _main.confidence = std::min(1.0f, window / m_settings.Tovms) * std::min(1.0f, _main.snr / 10.0f);
+    }
+    for(size_t i = 0; i < m_settings.bands.size(); i++) {
+        PulseEstimate &_estimate = v_estimates[i + 1];
+        const int _bottom = static_cast<int>(m_settings.bands[i].bottom * time / 1000.0f);
+        const int _top = std::min(_half, static_cast<int>(m_settings.bands[i].top * time / 1000.0f));
+        if(estimatePulseFrequency(power, _bottom, _top, time, _estimate.frequency, _estimate.snr)) {
+            _estimate.window = window;
+            _estimate.confidence = std::min(1.0f, window / m_settings.Tovms) * std::min(1.0f, _estimate.snr / 10.0f);
+        }
+    }
+    return _main.frequency;
+}
+
+float SpectrumEstimator::sparse()
+{
+    for(size_t i = 0; i < v_estimates.size(); i++)
+        v_estimates[i].snr = -10.0f;
+    return v_estimates[0].frequency;
+}
+
+bool SpectrumEstimator::isSparse(const float *signal, int length)
+{
+    int _zeros = 0;
+    for(int i = 0; i < length; i++) {
+        if(std::abs(signal[i]) <= 0.01f) {
+            _zeros++;
+        }
+    }
+    return _zeros > length/2;
+}
+
+const PulseEstimate &SpectrumEstimator::getEstimate(int band) const
+{
+    if(band <= 0 || band >= static_cast<int>(v_estimates.size()))
+        return v_estimates[0];
+    return v_estimates[band];
+}
+
+const std::vector<PulseEstimate> &SpectrumEstimator::getEstimates() const
+{
+    return v_estimates;
+}
+
+void SpectrumEstimator::setEstimates(const std::vector<PulseEstimate> &estimates)
+{
+    std::copy(estimates.begin(), estimates.begin() + std::min(estimates.size(), v_estimates.size()), v_estimates.begin());
+}
+
+ZoomSpectrum::ZoomSpectrum(int zoom) :
+    m_zoom(zoom),
+    f_dirty(true),
+    m_length(0),
+    m_first(0),
+    m_last(0),
+    m_points(0)
+{
+}
+
+void ZoomSpectrum::invalidate()
+{
+    f_dirty = true;
+}
+
+void ZoomSpectrum::__prepare(int length, int first, int last)
+{
+    // X(k) = sum x(n) A^-n W^nk, A = exp(j2pi*first/N), W = exp(-j2pi/(N*zoom)), nk = (n^2 + k^2 - (k-n)^2)/2,
+    // so the points are given by the convolution of x(n) A^-n W^(n^2/2) with W^(-m^2/2), |W^(k^2/2)| = 1 is omitted
+    m_length = length;
+    m_first = first;
+    m_last = last;
+    m_points = (last - first) * m_zoom + 1;
+    const int _length = cv::getOptimalDFTSize(m_length + m_points - 1);
+    const long _period = 2L * m_length * m_zoom; // chirp phase is periodic in n^2
+    const double _step = CV_PI / (static_cast<double>(m_length) * m_zoom);
+
+    v_chirp.create(1, m_length, CV_32FC2);
+    float *_chirp = v_chirp.ptr<float>(0);
+    for(int n = 0; n < m_length; n++) {
+        const double _phase = -2.0 * CV_PI * ((static_cast<long>(first) * n) % m_length) / m_length
+                              - _step * ((static_cast<long>(n) * n) % _period);
+        _chirp[2*n] = static_cast<float>(std::cos(_phase));
+        _chirp[2*n+1] = static_cast<float>(std::sin(_phase));
+    }
+
+    cv::Mat _kernel = cv::Mat::zeros(1, _length, CV_32FC2);
+    float *_h = _kernel.ptr<float>(0);
+    for(int m = 1 - m_length; m < m_points; m++) {
+        const double _phase = _step * ((static_cast<long>(m) * m) % _period);
+        const int i = m < 0 ? m + _length : m;
+        _h[2*i] = static_cast<float>(std::cos(_phase));
+        _h[2*i+1] = static_cast<float>(std::sin(_phase));
+    }
+    cv::dft(_kernel, v_kernel);
+
+    v_buffer.create(1, _length, CV_32FC2);
+    v_power.resize(m_points);
+    f_dirty = false;
+}
+
+float ZoomSpectrum::refine(const SpectrumSettings &settings, float frequency, int bottom, int top, float time, const float *signal)
+{
+    if(f_dirty) {
+        int first, last;
+        settings.nominalBins(settings.bottomHz, settings.topHz, first, last);
+        __prepare(settings.length, first, last);
+    }
+    if(bottom < m_first || top > m_last) // record duration has drifted out of the evaluated bins
+        __prepare(settings.length, std::min(bottom, m_first), std::max(top, m_last));
+
+    const float *_x = signal, *_chirp = v_chirp.ptr<const float>(0);
+    float *_y = v_buffer.ptr<float>(0);
+    for(int n = 0; n < m_length; n++) {
+        _y[2*n] = _x[n] * _chirp[2*n];
+        _y[2*n+1] = _x[n] * _chirp[2*n+1];
+    }
+    std::fill(_y + 2*m_length, _y + 2*v_buffer.cols, 0.0f);
+    cv::dft(v_buffer, v_buffer);
+    cv::mulSpectrums(v_buffer, v_kernel, v_buffer, 0);
+    cv::dft(v_buffer, v_buffer, cv::DFT_INVERSE | cv::DFT_SCALE);
+    const float *_z = v_buffer.ptr<const float>(0);
+    for(int m = 0; m < m_points; m++)
+        v_power[m] = _z[2*m]*_z[2*m] + _z[2*m+1]*_z[2*m+1];
+
+    // Peak is searched within one bin around the coarse estimation, so it is the same harmonic that snr has been computed for
+    const float _bin = frequency * time / 60000.0f;
+    const int _begin = std::max(0, static_cast<int>(std::ceil((std::max(static_cast<float>(bottom), _bin - 1.0f) - m_first) * m_zoom)));
+    const int _end = std::min(m_points - 1, static_cast<int>((std::min(static_cast<float>(top), _bin + 1.0f) - m_first) * m_zoom));
+    if(_begin > _end)
+        return frequency;
+    int _max = _begin;
+    for(int m = _begin + 1; m <= _end; m++)
+        if(v_power[m] > v_power[_max])
+            _max = m;
+
+    float _delta = 0.0f;
+    if(_max > 0 && _max < m_points - 1) {
+        const float _left = v_power[_max - 1], _right = v_power[_max + 1];
+        const float _curvature = _left - 2.0f * v_power[_max] + _right;
+        if(_curvature < 0.0f)
+            _delta = 0.5f * (_left - _right) / _curvature;
+    }
+    return (m_first + (_max + _delta) / m_zoom) * 60000.0f / time;
+}
+
+PrefixSpectrum::PrefixSpectrum(float minWindow_ms) :
+    m_minWindowms(minWindow_ms)
+{
+}
+
+void PrefixSpectrum::setMinWindow(float minWindow_ms)
+{
+    m_minWindowms = minWindow_ms;
+}
+
+float PrefixSpectrum::estimate(const SpectrumRecord &record, SpectrumEstimator &estimator)
+{
+    const SpectrumSettings &_settings = estimator.getSettings();
+    const int _length = _settings.length;
+    // Counts of the centering window warm-up are distorted, so they are dropped
+    const int _n = record.filled - _settings.warmup;
+    if(_n <= 0)
+        return estimator.getEstimate().frequency;
+    const float *_time = record.time + _length - _n;
+    float window = 0.0f;
+    for(int i = 0; i < _n; i++)
+        window += _time[i];
+    if(window < m_minWindowms)
+        return estimator.getEstimate().frequency;
+
+    const float *_prefix = record.signal + _length - _n;
+    if(SpectrumEstimator::isSparse(_prefix, _n))
+        return estimator.sparse();
+    // Prefix is padded by zeros to the signal length, so the bins have the same spacing as for the full record
+    v_padded.resize(_length);
+    std::fill(v_padded.begin(), v_padded.begin() + (_length - _n), 0.0f);
+    std::copy(_prefix, _prefix + _n, v_padded.begin() + (_length - _n));
+    v_power.resize(_length/2 + 1);
+    const cv::Mat _datamat(1, _length, CV_32F, v_padded.data());
+    cv::dft(_datamat, v_dftmat);
+    powerSpectrum(v_dftmat.ptr<const float>(0), _length, v_power.data());
+    return estimator.estimateByPower(v_power.data(), window * _length / _n, v_padded.data(), window);
+}
+
+} // end of namespace vpg
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2015, Taranov Alex <pi-null-mezon@yandex.ru>.
+ * Released to public domain under terms of the BSD Simplified license.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the organization nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *   See <http://www.opensource.org/licenses/bsd-license>
+ */
+#include "streammanager.h"
+
+namespace vpg {
+
+StreamManager::Stream::Stream(float dT_ms, float measInterval_ms, unsigned int maxQueuedFrames) :
+    pulseproc(dT_ms),
+    peakdetector(pulseproc.getLength(), 25, 11, dT_ms),
+    dTms(dT_ms),
+    measIntervalms(measInterval_ms),
+    elapsedms(0.0f),
+    maxQueuedFrames(std::max(1u, maxQueuedFrames)),
+    pushed(0),
+    scheduled(false),
+    removed(false)
+{
+    pulseproc.setPeakDetector(&peakdetector);
+}
+
+StreamManager::StreamManager(const std::string &filename, unsigned int threads) :
+    m_pool(threads),
+    m_nextId(0)
+{
+    // One cascade per worker, streams are served by any worker so they borrow the worker's one
+    v_classifiers.resize(m_pool.size());
+    for(size_t i = 0; i < v_classifiers.size(); i++)
+        v_classifiers[i].load(filename);
+}
+
+StreamManager::~StreamManager()
+{
+    std::vector<int> _ids;
+    {
+        std::lock_guard<std::mutex> _lock(m_mutex);
+        for(auto it = m_streams.begin(); it != m_streams.end(); ++it)
+            _ids.push_back(it->first);
+    }
+    for(size_t i = 0; i < _ids.size(); i++)
+        removeStream(_ids[i]);
+}
+
+int StreamManager::addStream(float dT_ms, float measInterval_ms, unsigned int maxQueuedFrames)
+{
+    std::shared_ptr<Stream> _stream = std::make_shared<Stream>(dT_ms, measInterval_ms, maxQueuedFrames);
+    std::lock_guard<std::mutex> _lock(m_mutex);
+    m_streams[m_nextId] = _stream;
+    return m_nextId++;
+}
+
+bool StreamManager::removeStream(int id)
+{
+    std::shared_ptr<Stream> _stream;
+    {
+        std::lock_guard<std::mutex> _lock(m_mutex);
+        auto it = m_streams.find(id);
+        if(it == m_streams.end())
+            return false;
+        _stream = it->second;
+        m_streams.erase(it);
+    }
+    std::unique_lock<std::mutex> _lock(_stream->mutex);
+    _stream->removed = true;
+    _stream->frames.clear();
+    _stream->idle.wait(_lock, [&_stream] { return !_stream->scheduled; });
+    return true;
+}
+
+bool StreamManager::pushFrame(int id, const cv::Mat &frame, float time_ms)
+{
+    std::shared_ptr<Stream> _stream = __find(id);
+    if(!_stream)
+        return false;
+    Frame _frame;
+    frame.copyTo(_frame.image);
+    _frame.time = time_ms > 0.0f ? time_ms : _stream->dTms;
+
+    bool _schedule = false;
+    {
+        std::lock_guard<std::mutex> _lock(_stream->mutex);
+        if(_stream->removed)
+            return false;
+        if(_stream->frames.size() == _stream->maxQueuedFrames) {
+            _stream->frames.pop_front();
+            _stream->result.dropped++;
+        }
+        _frame.number = ++_stream->pushed;
+        _stream->frames.push_back(_frame);
+        // Only one task per stream exists at a time, it keeps frames order
+        if(!_stream->scheduled) {
+            _stream->scheduled = true;
+            _schedule = true;
+        }
+    }
+    if(_schedule)
+        m_pool.submit([this, _stream] { __process(_stream); });
+    return true;
+}
+
+void StreamManager::__process(const std::shared_ptr<Stream> &stream)
+{
+    const int _worker = m_pool.currentWorker();
+    while(true) {
+        Frame _frame;
+        {
+            std::lock_guard<std::mutex> _lock(stream->mutex);
+            if(stream->frames.empty() || stream->removed) {
+                stream->scheduled = false;
+                stream->idle.notify_all();
+                return;
+            }
+            _frame = stream->frames.front();
+            stream->frames.pop_front();
+        }
+
+        stream->faceproc.setClassifier(&v_classifiers[_worker]);
+        float _value = 0.0f, _t = 0.0f;
+        stream->faceproc.enrollImage(_frame.image, _value, _t);
+        stream->pulseproc.update(_value, _frame.time);
+
+        StreamResult _result;
+        {
+            std::lock_guard<std::mutex> _lock(stream->mutex);
+            _result = stream->result;
+        }
+        stream->elapsedms += _frame.time;
+        if(stream->elapsedms >= stream->measIntervalms) {
+            stream->elapsedms = 0.0f;
+            _result.frequency = stream->pulseproc.computeFrequency();
+            _result.snr = stream->pulseproc.getSNR();
+            _result.cardiointerval = stream->peakdetector.averageCardiointervalms();
+            stream->hrvproc.enrollIntervals(stream->peakdetector.getIntervalsVector(), stream->peakdetector.getIntervalsLength());
+            _result.lf2hf = stream->hrvproc.computeLF2HF();
+        }
+        _result.faceRect = stream->faceproc.getFaceRect();
+        {
+            std::lock_guard<std::mutex> _lock(stream->mutex);
+            _result.dropped = stream->result.dropped;
+            _result.frames = stream->result.frames + 1;
+            _result.lastFrame = _frame.number;
+            stream->result = _result;
+        }
+    }
+}
+
+bool StreamManager::getResult(int id, StreamResult &result) const
+{
+    std::shared_ptr<Stream> _stream = __find(id);
+    if(!_stream)
+        return false;
+    std::lock_guard<std::mutex> _lock(_stream->mutex);
+    result = _stream->result;
+    return true;
+}
+
+size_t StreamManager::streams() const
+{
+    std::lock_guard<std::mutex> _lock(m_mutex);
+    return m_streams.size();
+}
+
+void StreamManager::wait()
+{
+    m_pool.wait();
+}
+
+std::shared_ptr<StreamManager::Stream> StreamManager::__find(int id) const
+{
+    std::lock_guard<std::mutex> _lock(m_mutex);
+    auto it = m_streams.find(id);
+    return it != m_streams.end() ? it->second : std::shared_ptr<Stream>();
+}
+
+} // end of namespace vpg
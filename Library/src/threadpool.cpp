@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2015, Taranov Alex <pi-null-mezon@yandex.ru>.
+ * Released to public domain under terms of the BSD Simplified license.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the organization nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *   See <http://www.opensource.org/licenses/bsd-license>
+ */
+#include "threadpool.h"
+
+#include <algorithm>
+
+namespace vpg {
+
+namespace {
+// Pool and index of the worker that runs on the current thread
+thread_local const ThreadPool *pt_currentPool = 0;
+thread_local int _currentWorker = -1;
+}
+
+ThreadPool::ThreadPool(unsigned int threads) :
+    m_queued(0),
+    m_pending(0),
+    m_sleeping(0),
+    m_next(0),
+    f_stop(false)
+{
+    if(threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    for(unsigned int i = 0; i < threads; i++)
+        v_workers.push_back(std::unique_ptr<Worker>(new Worker));
+    for(unsigned int i = 0; i < threads; i++)
+        v_threads.push_back(std::thread(&ThreadPool::__run, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> _lock(m_mutex);
+        f_stop = true;
+    }
+    m_wakeup.notify_all();
+    for(size_t i = 0; i < v_threads.size(); i++)
+        v_threads[i].join();
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    int _index = currentWorker();
+    if(_index < 0)
+        _index = static_cast<int>(m_next++ % v_workers.size());
+    m_pending++;
+    {
+        std::lock_guard<std::mutex> _lock(v_workers[_index]->mutex);
+        v_workers[_index]->tasks.push_back(std::move(task));
+    }
+    m_queued++;
+    // Sleeper increments m_sleeping and checks m_queued under m_mutex, so either it sees the task or it is notified here
+    if(m_sleeping > 0) {
+        { std::lock_guard<std::mutex> _lock(m_mutex); }
+        m_wakeup.notify_one();
+    }
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> _lock(m_mutex);
+    m_done.wait(_lock, [this] { return m_pending == 0; });
+}
+
+unsigned int ThreadPool::size() const
+{
+    return static_cast<unsigned int>(v_workers.size());
+}
+
+int ThreadPool::currentWorker() const
+{
+    return pt_currentPool == this ? _currentWorker : -1;
+}
+
+void ThreadPool::__run(unsigned int index)
+{
+    pt_currentPool = this;
+    _currentWorker = static_cast<int>(index);
+    std::function<void()> _task;
+    while(true) {
+        if(!__pop(index, _task)) {
+            std::unique_lock<std::mutex> _lock(m_mutex);
+            m_sleeping++;
+            m_wakeup.wait(_lock, [this] { return m_queued > 0 || f_stop; });
+            m_sleeping--;
+            if(f_stop && m_queued == 0)
+                return;
+            continue;
+        }
+        m_queued--;
+        _task();
+        _task = nullptr;
+        if(--m_pending == 0) {
+            { std::lock_guard<std::mutex> _lock(m_mutex); }
+            m_done.notify_all();
+        }
+    }
+}
+
+bool ThreadPool::__pop(unsigned int index, std::function<void()> &task)
+{
+    {
+        Worker &_own = *v_workers[index];
+        std::lock_guard<std::mutex> _lock(_own.mutex);
+        if(!_own.tasks.empty()) {
+            task = std::move(_own.tasks.back());
+            _own.tasks.pop_back();
+            return true;
+        }
+    }
+    for(size_t i = 1; i < v_workers.size(); i++) {
+        Worker &_victim = *v_workers[(index + i) % v_workers.size()];
+        std::lock_guard<std::mutex> _lock(_victim.mutex);
+        if(!_victim.tasks.empty()) {
+            task = std::move(_victim.tasks.front());
+            _victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+} // end of namespace vpg
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2015, Taranov Alex <pi-null-mezon@yandex.ru>.
+ * Released to public domain under terms of the BSD Simplified license.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of the organization nor the names of its contributors
+ *     may be used to endorse or promote products derived from this software
+ *     without specific prior written permission.
+ *
+ *   See <http://www.opensource.org/licenses/bsd-license>
+ */
+#include "videopipeline.h"
+
+#include <chrono>
+
+namespace vpg {
+
+VideoPipeline::VideoPipeline(cv::VideoCapture *capture, FaceProcessor *faceproc, PulseProcessor *pulseproc, float measInterval_ms,
+                             float framePeriod_ms, size_t ringSize, PeakDetector *peakdetector) :
+    pt_capture(capture),
+    pt_faceproc(faceproc),
+    pt_pulseproc(pulseproc),
+    pt_peakdetector(peakdetector),
+    m_measIntervalms(measInterval_ms),
+    m_framePeriodms(framePeriod_ms),
+    m_captured(ringSize),
+    m_enrolled(ringSize),
+    m_processed(ringSize),
+    m_periodEstimator(pulseproc->getSamplingPeriod()),
+    f_run(false)
+{
+    for(int i = 0; i < 3; i++)
+        v_done[i] = true;
+}
+
+VideoPipeline::~VideoPipeline()
+{
+    stop();
+}
+
+void VideoPipeline::start()
+{
+    if(!v_threads.empty())
+        return;
+    f_run = true;
+    for(int i = 0; i < 3; i++)
+        v_done[i] = false;
+    pt_faceproc->dropTimer();
+    v_threads.push_back(std::thread(&VideoPipeline::__capture, this));
+    v_threads.push_back(std::thread(&VideoPipeline::__enroll, this));
+    v_threads.push_back(std::thread(&VideoPipeline::__pulse, this));
+}
+
+void VideoPipeline::stop()
+{
+    f_run = false;
+    for(size_t i = 0; i < v_threads.size(); i++)
+        v_threads[i].join();
+    v_threads.clear();
+}
+
+bool VideoPipeline::pop(PipelineFrame &frame)
+{
+    if(m_framePeriodms > 0.0f)
+        return m_processed.pop(frame);
+    return __popLatest(m_processed, frame, Pulse);
+}
+
+bool VideoPipeline::finished() const
+{
+    return v_done[Pulse] && (m_processed.size() == 0);
+}
+
+StageStats VideoPipeline::getStats(Stage stage) const
+{
+    const Counters &_counters = v_counters[stage];
+    StageStats _stats;
+    _stats.processed = _counters.processed;
+    _stats.dropped = _counters.dropped;
+    const double _msPerTick = 1000.0 / cv::getTickFrequency();
+    _stats.averageLatency = _stats.processed > 0 ? static_cast<float>(_counters.totalTicks * _msPerTick / _stats.processed) : 0.0f;
+    _stats.maxLatency = static_cast<float>(_counters.maxTicks * _msPerTick);
+    switch(stage) {
+        case Capture:
+            _stats.queueDepth = m_captured.size();
+            break;
+        case Enroll:
+            _stats.queueDepth = m_enrolled.size();
+            break;
+        case Pulse:
+            _stats.queueDepth = m_processed.size();
+            break;
+    }
+    return _stats;
+}
+
+void VideoPipeline::__capture()
+{
+    unsigned long _number = 0;
+    while(f_run) {
+        PipelineFrame _frame;
+        const int64 _start = cv::getTickCount();
+        if(!pt_capture->read(_frame.image))
+            break;
+        _frame.number = _number++;
+        _frame.captureTick = cv::getTickCount();
+        // Video device should not wait, otherwise frames will be lost by the driver with unknown timing,
+        // ring is full only if enrollment is stuck for the whole ring, consumer drops the older frames otherwise
+        if(m_framePeriodms > 0.0f) {
+            while(f_run && !m_captured.push(_frame))
+                __wait();
+        } else if(!m_captured.push(_frame)) {
+            v_counters[Capture].dropped++;
+        }
+        __account(Capture, _start);
+    }
+    v_done[Capture] = true;
+}
+
+void VideoPipeline::__enroll()
+{
+    bool _first = true;
+    unsigned long _lastNumber = 0;
+    int64 _lastTick = 0;
+    while(f_run) {
+        PipelineFrame _frame;
+        const bool _popped = m_framePeriodms > 0.0f ? m_captured.pop(_frame) : __popLatest(m_captured, _frame, Capture);
+        if(!_popped) {
+            if(v_done[Capture] && m_captured.size() == 0)
+                break;
+            __wait();
+            continue;
+        }
+        const int64 _start = cv::getTickCount();
+        float _t = 0.0f;
+        pt_faceproc->enrollImage(_frame.image, _frame.value, _t);
+        _frame.faceRect = pt_faceproc->getFaceRect();
+        // Sample time is taken from the capture moments, so it does not depend on the processing time
+        if(m_framePeriodms > 0.0f)
+            _frame.time = _first ? m_framePeriodms : m_framePeriodms * (_frame.number - _lastNumber);
+        else
+            _frame.time = _first ? _t : static_cast<float>(1000.0 * (_frame.captureTick - _lastTick) / cv::getTickFrequency());
+        _first = false;
+        _lastNumber = _frame.number;
+        _lastTick = _frame.captureTick;
+
+        while(f_run && !m_enrolled.push(_frame))
+            __wait();
+        __account(Enroll, _start);
+    }
+    v_done[Enroll] = true;
+}
+
+void VideoPipeline::__pulse()
+{
+    float _timeout = m_measIntervalms;
+    while(f_run) {
+        PipelineFrame _frame;
+        if(!m_enrolled.pop(_frame)) {
+            if(v_done[Enroll] && m_enrolled.size() == 0)
+                break;
+            __wait();
+            continue;
+        }
+        const int64 _start = cv::getTickCount();
+        if(m_framePeriodms <= 0.0f && m_periodEstimator.update(1000.0 * _frame.captureTick / cv::getTickFrequency()))
+            pt_pulseproc->setSamplingPeriod(m_periodEstimator.getPeriod());
+        pt_pulseproc->update(_frame.value, _frame.time);
+        _timeout -= _frame.time;
+        _frame.measured = _timeout < 0.0f;
+        if(_frame.measured) {
+            pt_pulseproc->computeFrequency();
+            _timeout = m_measIntervalms;
+        }
+        _frame.frequency = pt_pulseproc->getFrequency();
+        _frame.snr = pt_pulseproc->getSNR();
+        _frame.sample = pt_pulseproc->getSignalSampleValue();
+        _frame.signal.assign(pt_pulseproc->getSignal(), pt_pulseproc->getSignal() + pt_pulseproc->getLength());
+        if(pt_peakdetector != 0) {
+            _frame.binarySignal.assign(pt_peakdetector->getBinarySignal(), pt_peakdetector->getBinarySignal() + pt_peakdetector->getSignalLength());
+            _frame.intervals.assign(pt_peakdetector->getIntervalsVector(), pt_peakdetector->getIntervalsVector() + pt_peakdetector->getIntervalsLength());
+            _frame.cardiointerval = pt_peakdetector->averageCardiointervalms();
+        }
+        _frame.latency = static_cast<float>(1000.0 * (cv::getTickCount() - _frame.captureTick) / cv::getTickFrequency());
+
+        if(m_framePeriodms > 0.0f) {
+            while(f_run && !m_processed.push(_frame))
+                __wait();
+        } else if(!m_processed.push(_frame)) {
+            v_counters[Pulse].dropped++;
+        }
+        __account(Pulse, _start);
+    }
+    v_done[Pulse] = true;
+}
+
+bool VideoPipeline::__popLatest(SPSCRing<PipelineFrame> &ring, PipelineFrame &frame, Stage stage)
+{
+    if(!ring.pop(frame))
+        return false;
+    PipelineFrame _next;
+    while(ring.pop(_next)) {
+        _next.measured = _next.measured || frame.measured;
+        std::swap(frame, _next);
+        v_counters[stage].dropped++;
+    }
+    return true;
+}
+
+void VideoPipeline::__account(Stage stage, int64 startTick)
+{
+    Counters &_counters = v_counters[stage];
+    const int64 _ticks = cv::getTickCount() - startTick;
+    _counters.processed++;
+    _counters.totalTicks += _ticks;
+    int64 _max = _counters.maxTicks;
+    while(_ticks > _max && !_counters.maxTicks.compare_exchange_weak(_max, _ticks)) {}
+}
+
+void VideoPipeline::__wait() const
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+}
+
+} // end of namespace vpg